@@ -0,0 +1,90 @@
+#ifndef BENCH_LINES_HPP
+#define BENCH_LINES_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+inline constexpr std::size_t bench_line_count = 1000000;
+
+// Lines laid out like spike --log-commits output: register writes, loads,
+// stores and compressed codes in a fixed pseudo-random mix.
+inline std::vector<std::string> make_bench_lines()
+{
+    std::vector<std::string> lines;
+    lines.reserve(bench_line_count);
+    uint64_t state = 0x9e3779b97f4a7c15;
+    uint64_t pc = 0x80000000;
+    char buf[160];
+    for (std::size_t i = 0; i < bench_line_count; i++)
+    {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        const uint32_t r = static_cast<uint32_t>(state >> 32);
+        const bool compressed = r & 1;
+        const uint32_t code = compressed ? (r >> 8) & 0xfffc : (r | 0x3);
+        const char *format = compressed ? "core   0: 3 0x%016llx (0x%04x)" : "core   0: 3 0x%016llx (0x%08x)";
+        int n = std::snprintf(buf, sizeof(buf), format, static_cast<unsigned long long>(pc), code);
+        switch ((r >> 4) % 4)
+        {
+        case 0:
+            std::snprintf(buf + n, sizeof(buf) - n, " x%-2u 0x%016llx", (r >> 10) % 32,
+                          static_cast<unsigned long long>(state));
+            break;
+        case 1:
+            std::snprintf(buf + n, sizeof(buf) - n, " x%-2u 0x%016llx mem 0x%016llx", (r >> 10) % 32,
+                          static_cast<unsigned long long>(state), static_cast<unsigned long long>(pc + 0x20000));
+            break;
+        case 2:
+            std::snprintf(buf + n, sizeof(buf) - n, " mem 0x%016llx 0x%016llx",
+                          static_cast<unsigned long long>(pc + 0x20000), static_cast<unsigned long long>(state));
+            break;
+        default:
+            break;
+        }
+        lines.emplace_back(buf);
+        pc += compressed ? 2 : 4;
+    }
+    return lines;
+}
+
+// The first bench_line_count lines of path, or make_bench_lines() for null.
+inline std::vector<std::string> load_bench_lines(const char *path)
+{
+    if (!path)
+        return make_bench_lines();
+
+    std::ifstream file(path);
+    if (!file)
+        throw std::runtime_error(std::string("Cannot open ") + path);
+    std::vector<std::string> lines;
+    std::string line;
+    while (lines.size() < bench_line_count && std::getline(file, line))
+        lines.push_back(line);
+    return lines;
+}
+
+inline std::size_t total_bytes(const std::vector<std::string> &lines)
+{
+    std::size_t bytes = 0;
+    for (const std::string &line : lines)
+        bytes += line.size() + 1;
+    return bytes;
+}
+
+// Runs fn over every line repeats times and returns the mean ns per line.
+template <typename Fn>
+double time_per_line(const std::vector<std::string> &lines, int repeats, Fn fn)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        for (const std::string &line : lines)
+            fn(line);
+    const auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / (double(lines.size()) * repeats);
+}
+
+#endif
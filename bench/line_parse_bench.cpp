@@ -0,0 +1,61 @@
+// Times try_extract_instruction_from_line against the stringstream based
+// extraction it replaced.
+//
+//   make bench                          synthetic spike lines
+//   build/bench/line_parse_bench FILE   the first lines of a trace
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench_lines.hpp"
+#include "line_parse.hpp"
+
+// extract_instruction_from_line as it was before the string_view fast path
+static uint32_t extract_with_stringstream(const std::string &line)
+{
+    size_t leftParen = line.find('(');
+    size_t rightParen = line.find(')');
+    if (leftParen == std::string::npos || rightParen == std::string::npos || rightParen <= leftParen)
+        throw std::runtime_error("Cannot find instruction code in input line.");
+
+    std::string hexStr = line.substr(leftParen + 1, rightParen - leftParen - 1);
+    uint32_t code = 0;
+    hexStr.erase(remove_if(hexStr.begin(), hexStr.end(), isspace), hexStr.end());
+
+    std::stringstream ss(hexStr);
+    if (hexStr.compare(0, 2, "0x") == 0 || hexStr.compare(0, 2, "0X") == 0)
+        ss >> std::hex >> code;
+    else
+        ss >> code;
+    return code;
+}
+
+int main(int argc, char *argv[])
+{
+    const std::vector<std::string> lines = load_bench_lines(argc > 1 ? argv[1] : nullptr);
+
+    uint64_t old_sum = 0;
+    const double old_ns = time_per_line(lines, 1, [&](const std::string &line)
+                                        { old_sum += extract_with_stringstream(line); });
+
+    uint64_t new_sum = 0;
+    const double new_ns = time_per_line(lines, 10, [&](const std::string &line)
+                                        {
+                                            uint32_t code = 0;
+                                            try_extract_instruction_from_line(line, code);
+                                            new_sum += code; });
+
+    if (old_sum * 10 != new_sum)
+    {
+        std::fprintf(stderr, "the two extractions disagree\n");
+        return 1;
+    }
+    std::printf("extract_instruction_from_line, %zu lines\n", lines.size());
+    std::printf("  stringstream: %8.1f ns/line\n", old_ns);
+    std::printf("  string_view:  %8.1f ns/line (%.1fx)\n", new_ns, old_ns / new_ns);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Throughput of parse_trace_record, which extracts every field of a commit
+// log line, next to the opcode-only extraction for comparison.
+//
+//   make bench                            synthetic spike lines
+//   build/bench/trace_record_bench FILE   the first lines of a trace
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench_lines.hpp"
+#include "line_parse.hpp"
+
+int main(int argc, char *argv[])
+{
+    const std::vector<std::string> lines = load_bench_lines(argc > 1 ? argv[1] : nullptr);
+    const double mb = total_bytes(lines) / 1e6;
+
+    uint64_t parsed = 0;
+    uint64_t fields = 0;
+    const double record_ns = time_per_line(lines, 10, [&](const std::string &line)
+                                           {
+                                               TraceRecord record;
+                                               if (parse_trace_record(line, record))
+                                               {
+                                                   parsed++;
+                                                   fields += record.pc + record.reg_write_count;
+                                                   fields += record.mem_access_count;
+                                               }
+                                           });
+
+    uint64_t codes = 0;
+    const double code_ns = time_per_line(lines, 10, [&](const std::string &line)
+                                         {
+                                             uint32_t code = 0;
+                                             try_extract_instruction_from_line(line, code);
+                                             codes += code;
+                                         });
+
+    const double line_mb = mb / lines.size();
+    std::printf("parse_trace_record, %zu lines, %.1f MB (%llu parsed, checksum %llx)\n", lines.size(), mb,
+                static_cast<unsigned long long>(parsed / 10), static_cast<unsigned long long>(fields + codes));
+    std::printf("  all fields:   %8.1f ns/line %8.0f MB/s\n", record_ns, line_mb / record_ns * 1e9);
+    std::printf("  opcode only:  %8.1f ns/line %8.0f MB/s\n", code_ns, line_mb / code_ns * 1e9);
+    return parsed ? 0 : 1;
+}
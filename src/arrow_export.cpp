@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "arrow_export.hpp"
+
+// constants from the Arrow flatbuffers schemas (Schema.fbs, Message.fbs)
+static constexpr int16_t metadata_version_v5 = 4;
+static constexpr uint8_t header_schema = 1;
+static constexpr uint8_t header_dictionary_batch = 2;
+static constexpr uint8_t header_record_batch = 3;
+static constexpr uint8_t type_int = 2;
+static constexpr uint8_t type_utf8 = 5;
+static constexpr uint8_t type_bool = 6;
+
+static constexpr char file_magic[8] = {'A', 'R', 'R', 'O', 'W', '1', '\0', '\0'};
+
+static std::size_t round_up(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static void append_le(std::string &out, uint64_t value, unsigned size)
+{
+    for (unsigned i = 0; i < size; i++)
+        out.push_back(static_cast<char>(value >> (8 * i)));
+}
+
+// Minimal FlatBuffers writer. Unlike the official builder it works front to
+// back: a table is written before its children, and the (always forward)
+// offsets to them are patched in once the children are placed.
+class FlatBuilder
+{
+public:
+    using Child = std::function<std::size_t(FlatBuilder &)>;
+
+    struct Field
+    {
+        unsigned id;
+        // bytes of an inline scalar, 0 for an offset to a child object
+        unsigned size;
+        uint64_t value;
+        Child child;
+    };
+
+    static Field scalar(unsigned id, unsigned size, uint64_t value) { return Field{id, size, value, nullptr}; }
+
+    static Field offset(unsigned id, Child child) { return Field{id, 0, 0, std::move(child)}; }
+
+    // starts with the root offset, patched by finish
+    std::string buffer = std::string(4, '\0');
+
+    void finish(std::size_t root) { patch(0, root); }
+
+    std::size_t table(std::vector<Field> fields)
+    {
+        // largest fields first, so only the soffset can need padding after it
+        std::stable_sort(fields.begin(), fields.end(), [](const Field &a, const Field &b)
+                         { return width(a) > width(b); });
+
+        std::vector<uint16_t> at(fields.size());
+        std::size_t pos = 4;
+        std::size_t alignment = 4;
+        unsigned slots = 0;
+        for (std::size_t i = 0; i < fields.size(); i++)
+        {
+            pos = round_up(pos, width(fields[i]));
+            at[i] = static_cast<uint16_t>(pos);
+            pos += width(fields[i]);
+            alignment = std::max<std::size_t>(alignment, width(fields[i]));
+            slots = std::max(slots, fields[i].id + 1);
+        }
+
+        pad_to(2);
+        const std::size_t vtable = buffer.size();
+        std::vector<uint16_t> entries(slots, 0);
+        for (std::size_t i = 0; i < fields.size(); i++)
+            entries[fields[i].id] = at[i];
+        append_le(buffer, 4 + 2 * slots, 2);
+        append_le(buffer, pos, 2);
+        for (uint16_t entry : entries)
+            append_le(buffer, entry, 2);
+
+        pad_to(alignment);
+        const std::size_t table = buffer.size();
+        // the vtable sits at table - soffset
+        append_le(buffer, table - vtable, 4);
+        buffer.resize(table + pos, '\0');
+        for (std::size_t i = 0; i < fields.size(); i++)
+        {
+            if (!fields[i].child)
+                write_le(table + at[i], fields[i].value, fields[i].size);
+        }
+        for (std::size_t i = 0; i < fields.size(); i++)
+        {
+            if (fields[i].child)
+                patch(table + at[i], fields[i].child(*this));
+        }
+        return table;
+    }
+
+    std::size_t string(std::string_view text)
+    {
+        pad_to(4);
+        const std::size_t pos = buffer.size();
+        append_le(buffer, text.size(), 4);
+        buffer += text;
+        buffer.push_back('\0');
+        return pos;
+    }
+
+    // vector of 8-byte aligned structs, already packed into bytes
+    std::size_t struct_vector(std::string_view bytes, std::size_t count)
+    {
+        while ((buffer.size() + 4) % 8)
+            buffer.push_back('\0');
+        const std::size_t pos = buffer.size();
+        append_le(buffer, count, 4);
+        buffer += bytes;
+        return pos;
+    }
+
+    std::size_t table_vector(const std::vector<Child> &children)
+    {
+        pad_to(4);
+        const std::size_t pos = buffer.size();
+        append_le(buffer, children.size(), 4);
+        buffer.append(4 * children.size(), '\0');
+        for (std::size_t i = 0; i < children.size(); i++)
+            patch(pos + 4 + 4 * i, children[i](*this));
+        return pos;
+    }
+
+private:
+    static std::size_t width(const Field &field) { return field.child ? 4 : field.size; }
+
+    void pad_to(std::size_t alignment)
+    {
+        buffer.resize(round_up(buffer.size(), alignment), '\0');
+    }
+
+    void write_le(std::size_t at, uint64_t value, unsigned size)
+    {
+        for (unsigned i = 0; i < size; i++)
+            buffer[at + i] = static_cast<char>(value >> (8 * i));
+    }
+
+    void patch(std::size_t at, std::size_t target)
+    {
+        write_le(at, target - at, 4);
+    }
+};
+
+using FB = FlatBuilder;
+
+struct ColumnSpec
+{
+    const char *name;
+    uint8_t type;
+    unsigned bits;
+    bool is_signed;
+    // -1 for plain columns
+    int64_t dictionary_id;
+    unsigned index_bits;
+};
+
+static constexpr int64_t mnemonic_dictionary = 0;
+static constexpr int64_t format_dictionary = 1;
+
+static constexpr ColumnSpec column_specs[] = {
+    {"pc", type_int, 64, false, -1, 0},
+    {"code", type_int, 32, false, -1, 0},
+    {"mnemonic", type_utf8, 0, false, mnemonic_dictionary, 16},
+    {"format", type_utf8, 0, false, format_dictionary, 8},
+    {"rd", type_int, 8, false, -1, 0},
+    {"rs1", type_int, 8, false, -1, 0},
+    {"rs2", type_int, 8, false, -1, 0},
+    {"imm", type_int, 32, true, -1, 0},
+    {"compressed", type_bool, 0, false, -1, 0},
+};
+
+static constexpr std::size_t column_count = std::size(column_specs);
+
+static std::size_t int_type(FB &b, unsigned bits, bool is_signed)
+{
+    return b.table({FB::scalar(0, 4, bits), FB::scalar(1, 1, is_signed)});
+}
+
+// table Field { name, nullable, type_type, type, dictionary, children }
+static std::size_t field(FB &b, const ColumnSpec &spec)
+{
+    std::vector<FB::Field> fields{
+        FB::offset(0, [&](FB &b)
+                   { return b.string(spec.name); }),
+        FB::scalar(1, 1, false),
+        FB::scalar(2, 1, spec.type),
+        FB::offset(3, [&](FB &b)
+                   { return spec.type == type_int ? int_type(b, spec.bits, spec.is_signed) : b.table({}); }),
+        FB::offset(5, [](FB &b)
+                   { return b.table_vector({}); }),
+    };
+    if (spec.dictionary_id >= 0)
+    {
+        // table DictionaryEncoding { id, indexType, isOrdered }
+        fields.push_back(FB::offset(4, [&](FB &b)
+                                    { return b.table({FB::scalar(0, 8, spec.dictionary_id),
+                                                      FB::offset(1, [&](FB &b)
+                                                                 { return int_type(b, spec.index_bits, true); }),
+                                                      FB::scalar(2, 1, false)}); }));
+    }
+    return b.table(std::move(fields));
+}
+
+// table Schema { endianness, fields }
+static std::size_t schema(FB &b)
+{
+    std::vector<FB::Child> fields;
+    for (const ColumnSpec &spec : column_specs)
+        fields.push_back([&](FB &b)
+                         { return field(b, spec); });
+    return b.table({FB::scalar(0, 2, 0), FB::offset(1, [&](FB &b)
+                                                    { return b.table_vector(fields); })});
+}
+
+// table Message { version, header_type, header, bodyLength }
+static std::string message(uint8_t header_type, const FB::Child &header, std::size_t body_length)
+{
+    FB b;
+    b.finish(b.table({FB::scalar(0, 2, metadata_version_v5), FB::scalar(1, 1, header_type), FB::offset(2, header),
+                      FB::scalar(3, 8, body_length)}));
+    return std::move(b.buffer);
+}
+
+// Message body: buffers back to back, each padded to 8 bytes.
+class BodyBuilder
+{
+public:
+    std::string body;
+    // (offset, length) of each buffer, packed as Buffer structs
+    std::string buffers;
+    std::size_t buffer_count = 0;
+
+    void add(const void *data, std::size_t size)
+    {
+        append_le(buffers, body.size(), 8);
+        append_le(buffers, size, 8);
+        buffer_count++;
+        body.append(static_cast<const char *>(data), size);
+        body.resize(round_up(body.size(), 8), '\0');
+    }
+
+    // absent validity bitmap: no nulls
+    void add_empty() { add(nullptr, 0); }
+};
+
+// table RecordBatch { length, nodes, buffers }; every column has one node
+static std::size_t record_batch(FB &b, std::size_t length, std::size_t columns, const BodyBuilder &body)
+{
+    std::string nodes;
+    for (std::size_t i = 0; i < columns; i++)
+    {
+        append_le(nodes, length, 8);
+        append_le(nodes, 0, 8);
+    }
+    return b.table({FB::scalar(0, 8, length), FB::offset(1, [&](FB &b)
+                                                         { return b.struct_vector(nodes, columns); }),
+                    FB::offset(2, [&](FB &b)
+                               { return b.struct_vector(body.buffers, body.buffer_count); })});
+}
+
+template <typename T>
+static void add_column(BodyBuilder &body, const std::vector<T> &values)
+{
+    body.add_empty();
+    body.add(values.data(), values.size() * sizeof(T));
+}
+
+static int open_output(const std::string &file_name)
+{
+    int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not create file: " + file_name);
+    }
+    return fd;
+}
+
+ArrowTraceWriter::ArrowTraceWriter(const std::string &file_name, std::size_t batch_rows)
+    : m_fd(open_output(file_name)), m_out(m_fd), m_batch_rows(batch_rows)
+{
+    m_out.write(std::string_view(file_magic, sizeof(file_magic)));
+    m_offset = sizeof(file_magic);
+
+    write_message(message(header_schema, schema, 0), "");
+    write_dictionary(mnemonic_dictionary, std::vector<std::string_view>(insts_mnem_map.begin(), insts_mnem_map.end()));
+    write_dictionary(format_dictionary, std::vector<std::string_view>(InstructionFormatStringMap.begin(),
+                                                                      InstructionFormatStringMap.end()));
+}
+
+ArrowTraceWriter::~ArrowTraceWriter()
+{
+    try
+    {
+        m_out.flush();
+    }
+    catch (...)
+    {
+        // nothing sensible left to do with a failed write during teardown
+    }
+    ::close(m_fd);
+}
+
+// Encapsulated message: 0xFFFFFFFF, metadata size, flatbuffer padded to 8
+// bytes, body.
+ArrowTraceWriter::BlockInfo ArrowTraceWriter::write_message(const std::string &metadata, const std::string &body)
+{
+    const std::size_t padded = round_up(metadata.size(), 8);
+    std::string prefix;
+    append_le(prefix, 0xffffffffu, 4);
+    append_le(prefix, padded, 4);
+
+    m_out.write(prefix);
+    m_out.write(metadata);
+    m_out.write(std::string(padded - metadata.size(), '\0'));
+    m_out.write(body);
+
+    BlockInfo block{m_offset, static_cast<uint32_t>(prefix.size() + padded), body.size()};
+    m_offset += block.metadata_length + block.body_length;
+    return block;
+}
+
+void ArrowTraceWriter::write_dictionary(int64_t id, const std::vector<std::string_view> &values)
+{
+    std::vector<int32_t> offsets{0};
+    std::string data;
+    for (std::string_view value : values)
+    {
+        data += value;
+        offsets.push_back(static_cast<int32_t>(data.size()));
+    }
+
+    // one utf8 column: validity, offsets, data
+    BodyBuilder body;
+    add_column(body, offsets);
+    body.add(data.data(), data.size());
+    auto header = [&](FB &b)
+    {
+        // table DictionaryBatch { id, data, isDelta }
+        return b.table({FB::scalar(0, 8, id), FB::offset(1, [&](FB &b)
+                                                         { return record_batch(b, values.size(), 1, body); }),
+                        FB::scalar(2, 1, false)});
+    };
+    m_dictionary_blocks.push_back(write_message(message(header_dictionary_batch, header, body.body.size()), body.body));
+}
+
+void ArrowTraceWriter::add(uint64_t pc, const DecodedInstruction &inst)
+{
+    m_pc.push_back(pc);
+    m_code.push_back(inst.code);
+    m_mnemonic.push_back(static_cast<int16_t>(inst.name));
+    m_format.push_back(static_cast<int8_t>(inst.format));
+    m_rd.push_back(inst.rd);
+    m_rs1.push_back(inst.rs1);
+    m_rs2.push_back(inst.rs2);
+    m_imm.push_back(inst.imm);
+    m_compressed.push_back(inst.compressed);
+    m_rows++;
+
+    if (m_pc.size() == m_batch_rows)
+        flush_batch();
+}
+
+void ArrowTraceWriter::flush_batch()
+{
+    const std::size_t rows = m_pc.size();
+    if (rows == 0)
+        return;
+
+    // booleans are bit-packed, least significant bit first
+    std::vector<uint8_t> compressed_bits((rows + 7) / 8);
+    for (std::size_t i = 0; i < rows; i++)
+    {
+        if (m_compressed[i])
+            compressed_bits[i / 8] |= 1 << (i % 8);
+    }
+
+    BodyBuilder body;
+    add_column(body, m_pc);
+    add_column(body, m_code);
+    add_column(body, m_mnemonic);
+    add_column(body, m_format);
+    add_column(body, m_rd);
+    add_column(body, m_rs1);
+    add_column(body, m_rs2);
+    add_column(body, m_imm);
+    add_column(body, compressed_bits);
+
+    auto header = [&](FB &b)
+    { return record_batch(b, rows, column_count, body); };
+    m_batch_blocks.push_back(write_message(message(header_record_batch, header, body.body.size()), body.body));
+
+    m_pc.clear();
+    m_code.clear();
+    m_mnemonic.clear();
+    m_format.clear();
+    m_rd.clear();
+    m_rs1.clear();
+    m_rs2.clear();
+    m_imm.clear();
+    m_compressed.clear();
+}
+
+void ArrowTraceWriter::finish()
+{
+    if (m_finished)
+        return;
+    flush_batch();
+
+    // struct Block { offset, metaDataLength, (padding), bodyLength }
+    auto pack_blocks = [](const std::vector<BlockInfo> &blocks)
+    {
+        std::string bytes;
+        for (const BlockInfo &block : blocks)
+        {
+            append_le(bytes, block.offset, 8);
+            append_le(bytes, block.metadata_length, 4);
+            append_le(bytes, 0, 4);
+            append_le(bytes, block.body_length, 8);
+        }
+        return bytes;
+    };
+    const std::string dictionaries = pack_blocks(m_dictionary_blocks);
+    const std::string batches = pack_blocks(m_batch_blocks);
+
+    // table Footer { version, schema, dictionaries, recordBatches }
+    FB b;
+    b.finish(b.table({FB::scalar(0, 2, metadata_version_v5), FB::offset(1, schema),
+                      FB::offset(2, [&](FB &b)
+                                 { return b.struct_vector(dictionaries, m_dictionary_blocks.size()); }),
+                      FB::offset(3, [&](FB &b)
+                                 { return b.struct_vector(batches, m_batch_blocks.size()); })}));
+
+    std::string trailer;
+    append_le(trailer, b.buffer.size(), 4);
+    trailer.append(file_magic, 6);
+    m_out.write(b.buffer);
+    m_out.write(trailer);
+    m_offset += b.buffer.size() + trailer.size();
+    m_out.flush();
+    m_finished = true;
+}
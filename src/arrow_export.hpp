@@ -0,0 +1,79 @@
+#ifndef ARROW_EXPORT_HPP
+#define ARROW_EXPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "instructions.hpp"
+#include "output.hpp"
+
+// Writes decoded instructions as an Arrow IPC file (the "Feather v2"
+// format), which pyarrow, pandas, polars and DuckDB memory-map without
+// copying. Columns:
+//   pc uint64, code uint32, mnemonic dictionary<int16, utf8>,
+//   format dictionary<int8, utf8>, rd uint8, rs1 uint8, rs2 uint8,
+//   imm int32, compressed bool
+// The mnemonic and format dictionaries are the decoder's complete name
+// tables, written once up front, so the index of a mnemonic is its
+// InstEnum value. Rows are buffered per record batch only, so memory does
+// not grow with the trace. No Arrow library is needed: the flatbuffers
+// metadata is written by hand.
+class ArrowTraceWriter
+{
+private:
+    struct BlockInfo
+    {
+        uint64_t offset;
+        uint32_t metadata_length;
+        uint64_t body_length;
+    };
+
+    int m_fd;
+    OutputBuffer m_out;
+    std::size_t m_batch_rows;
+    uint64_t m_offset = 0;
+    uint64_t m_rows = 0;
+    std::vector<BlockInfo> m_dictionary_blocks;
+    std::vector<BlockInfo> m_batch_blocks;
+    bool m_finished = false;
+
+    // columns of the batch being filled
+    std::vector<uint64_t> m_pc;
+    std::vector<uint32_t> m_code;
+    std::vector<int16_t> m_mnemonic;
+    std::vector<int8_t> m_format;
+    std::vector<uint8_t> m_rd;
+    std::vector<uint8_t> m_rs1;
+    std::vector<uint8_t> m_rs2;
+    std::vector<int32_t> m_imm;
+    std::vector<bool> m_compressed;
+
+    BlockInfo write_message(const std::string &metadata, const std::string &body);
+    void write_dictionary(int64_t id, const std::vector<std::string_view> &values);
+    void flush_batch();
+
+public:
+    static constexpr std::size_t default_batch_rows = 1 << 16;
+
+    explicit ArrowTraceWriter(const std::string &file_name, std::size_t batch_rows = default_batch_rows);
+
+    ~ArrowTraceWriter();
+
+    ArrowTraceWriter(const ArrowTraceWriter &) = delete;
+    ArrowTraceWriter &operator=(const ArrowTraceWriter &) = delete;
+
+    void add(uint64_t pc, const DecodedInstruction &inst);
+
+    // Writes the last batch and the footer; without it the file is not a
+    // valid Arrow file.
+    void finish();
+
+    uint64_t get_row_count() const { return m_rows; }
+
+    uint64_t get_bytes_written() const { return m_offset; }
+};
+
+#endif
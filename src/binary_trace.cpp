@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "binary_trace.hpp"
+
+static constexpr std::array<uint32_t, 256> crc32_table = []
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320u : 0);
+        table[i] = crc;
+    }
+    return table;
+}();
+
+// CRC-32 as used by gzip and zip
+static uint32_t crc32(std::string_view data)
+{
+    uint32_t crc = 0xffffffffu;
+    for (char c : data)
+        crc = crc32_table[(crc ^ static_cast<unsigned char>(c)) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xffffffffu;
+}
+
+static void put_u16(std::string &out, uint16_t value)
+{
+    out.push_back(static_cast<char>(value));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+static void put_u32(std::string &out, uint32_t value)
+{
+    for (int shift = 0; shift < 32; shift += 8)
+        out.push_back(static_cast<char>(value >> shift));
+}
+
+static uint32_t get_u32(const char *data)
+{
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--)
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    return value;
+}
+
+static void put_varint(std::string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+static uint64_t zigzag(uint64_t delta)
+{
+    return (delta << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(delta) >> 63);
+}
+
+static uint64_t unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+static uint64_t fall_through_pc(uint64_t pc, uint32_t code)
+{
+    return pc + ((code & 0x3) == 0x3 ? 4 : 2);
+}
+
+static std::size_t reg_slot(RegFile file, uint16_t num)
+{
+    return static_cast<std::size_t>(file) * 4096 + (num & 0xfff);
+}
+
+// Bounds-checked reader over one column.
+class ColumnReader
+{
+private:
+    const char *m_pos;
+    const char *m_end;
+
+    [[noreturn]] static void overrun()
+    {
+        throw std::runtime_error("Corrupt binary trace: column ends early");
+    }
+
+public:
+    ColumnReader() : m_pos(nullptr), m_end(nullptr) {}
+
+    explicit ColumnReader(std::string_view column) : m_pos(column.data()), m_end(column.data() + column.size()) {}
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (m_pos == m_end)
+                overrun();
+            const uint8_t byte = static_cast<uint8_t>(*m_pos++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        throw std::runtime_error("Corrupt binary trace: varint too long");
+    }
+
+    uint8_t byte()
+    {
+        if (m_pos == m_end)
+            overrun();
+        return static_cast<uint8_t>(*m_pos++);
+    }
+};
+
+bool is_binary_trace(std::string_view data)
+{
+    return data.size() >= sizeof(rvtb::magic) && memcmp(data.data(), rvtb::magic, sizeof(rvtb::magic)) == 0;
+}
+
+void BinaryBlockState::reset()
+{
+    next_pc = 0;
+    last_addr = 0;
+    std::fill(last_reg.begin(), last_reg.end(), 0);
+    by_pc.clear();
+}
+
+static int open_output(const std::string &file_name)
+{
+    int fd = ::open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not create file: " + file_name);
+    }
+    return fd;
+}
+
+BinaryTraceWriter::BinaryTraceWriter(const std::string &file_name, uint32_t block_records)
+    : m_fd(open_output(file_name)), m_out(m_fd), m_block_records(block_records)
+{
+    std::string header(rvtb::magic, sizeof(rvtb::magic));
+    put_u16(header, rvtb::version);
+    put_u16(header, rvtb::file_header_size);
+    put_u32(header, m_block_records);
+    put_u32(header, 0);
+    m_out.write(header);
+    m_bytes_written += header.size();
+}
+
+BinaryTraceWriter::~BinaryTraceWriter()
+{
+    try
+    {
+        m_out.flush();
+    }
+    catch (...)
+    {
+        // nothing sensible left to do with a failed write during teardown
+    }
+    ::close(m_fd);
+}
+
+void BinaryTraceWriter::add(const TraceRecord &record)
+{
+    auto [it, inserted] = m_dictionary.try_emplace(record.code, static_cast<uint32_t>(m_words.size()));
+    if (inserted)
+        m_words.push_back(record.code);
+
+    put_varint(m_columns[rvtb::PC], zigzag(record.pc - m_state.next_pc));
+    m_state.next_pc = fall_through_pc(record.pc, record.code);
+    put_varint(m_columns[rvtb::CODE], it->second);
+
+    uint8_t flags = record.reg_write_count | record.mem_access_count << 3 | (record.truncated ? 0x80 : 0);
+    for (std::size_t i = 0; i < record.mem_access_count; i++)
+    {
+        if (record.mem_accesses[i].store)
+            flags |= 0x20 << i;
+    }
+    m_columns[rvtb::FLAGS].push_back(static_cast<char>(flags));
+
+    if (m_run_length && (record.core != m_run_core || record.priv != m_run_priv))
+        flush_run();
+    m_run_core = record.core;
+    m_run_priv = record.priv;
+    m_run_length++;
+
+    BinaryBlockState::PcHistory &history = m_state.by_pc[record.pc];
+    for (std::size_t i = 0; i < record.reg_write_count; i++)
+    {
+        const RegWrite &write = record.reg_writes[i];
+        uint64_t &last = m_state.last_reg[reg_slot(write.file, write.num)];
+        const uint64_t predicted = i < history.reg_write_count ? history.reg_values[i] : last;
+        put_varint(m_columns[rvtb::REGS], static_cast<uint64_t>(write.num) << 2 | static_cast<uint64_t>(write.file));
+        put_varint(m_columns[rvtb::REGS], zigzag(write.value - predicted));
+        last = write.value;
+        history.reg_values[i] = write.value;
+    }
+
+    for (std::size_t i = 0; i < record.mem_access_count; i++)
+    {
+        const MemAccess &access = record.mem_accesses[i];
+        const bool seen = i < history.mem_access_count;
+        put_varint(m_columns[rvtb::MEM], zigzag(access.addr - (seen ? history.mem_addrs[i] : m_state.last_addr)));
+        m_state.last_addr = access.addr;
+        history.mem_addrs[i] = access.addr;
+        if (access.store)
+            put_varint(m_columns[rvtb::MEM], zigzag(access.data - (seen ? history.mem_data[i] : 0)));
+        history.mem_data[i] = access.data;
+    }
+    history.reg_write_count = record.reg_write_count;
+    history.mem_access_count = record.mem_access_count;
+
+    m_total_records++;
+    if (++m_count == m_block_records)
+        flush_block();
+}
+
+void BinaryTraceWriter::flush_run()
+{
+    put_varint(m_columns[rvtb::CONTEXT], m_run_length);
+    put_varint(m_columns[rvtb::CONTEXT], m_run_core);
+    m_columns[rvtb::CONTEXT].push_back(static_cast<char>(m_run_priv));
+    m_run_length = 0;
+}
+
+void BinaryTraceWriter::flush_block()
+{
+    if (m_run_length)
+        flush_run();
+
+    std::string payload;
+    for (uint32_t word : m_words)
+        put_u32(payload, word);
+    for (const std::string &column : m_columns)
+        payload += column;
+
+    std::string header;
+    put_u32(header, m_count);
+    put_u32(header, static_cast<uint32_t>(m_words.size()));
+    for (const std::string &column : m_columns)
+        put_u32(header, static_cast<uint32_t>(column.size()));
+    put_u32(header, crc32(payload));
+
+    m_out.write(header);
+    m_out.write(payload);
+    m_bytes_written += header.size() + payload.size();
+
+    m_count = 0;
+    m_state.reset();
+    m_dictionary.clear();
+    m_words.clear();
+    for (std::string &column : m_columns)
+        column.clear();
+}
+
+void BinaryTraceWriter::finish()
+{
+    if (m_finished)
+        return;
+    if (m_count)
+        flush_block();
+    // the end marker is an empty block
+    flush_block();
+    m_out.flush();
+    m_finished = true;
+}
+
+BinaryTraceReader::BinaryTraceReader(std::string_view data) : m_data(data)
+{
+    if (!is_binary_trace(data) || data.size() < rvtb::file_header_size)
+    {
+        throw std::runtime_error("Not a binary trace");
+    }
+    const uint16_t version = static_cast<uint16_t>(static_cast<unsigned char>(data[4]) |
+                                                   static_cast<unsigned char>(data[5]) << 8);
+    if (version != rvtb::version)
+    {
+        throw std::runtime_error("Unsupported binary trace version " + std::to_string(version));
+    }
+    const uint16_t header_size = static_cast<uint16_t>(static_cast<unsigned char>(data[6]) |
+                                                       static_cast<unsigned char>(data[7]) << 8);
+    m_pos = std::max<std::size_t>(header_size, rvtb::file_header_size);
+}
+
+bool BinaryTraceReader::read_block(TraceBlock &block, bool with_fields)
+{
+    block.pcs.clear();
+    block.codes.clear();
+    block.records.clear();
+    if (m_done)
+        return false;
+
+    const std::string where = " in block " + std::to_string(m_block_index);
+    if (m_data.size() - m_pos < rvtb::block_header_size)
+    {
+        throw std::runtime_error("Binary trace is truncated" + where);
+    }
+    const char *header = m_data.data() + m_pos;
+    const uint32_t count = get_u32(header);
+    const uint32_t dictionary_size = get_u32(header + 4);
+    std::array<uint32_t, rvtb::column_count> column_sizes;
+    std::size_t payload_size = std::size_t(dictionary_size) * 4;
+    for (std::size_t i = 0; i < rvtb::column_count; i++)
+    {
+        column_sizes[i] = get_u32(header + 8 + 4 * i);
+        payload_size += column_sizes[i];
+    }
+    const uint32_t checksum = get_u32(header + 8 + 4 * rvtb::column_count);
+
+    m_pos += rvtb::block_header_size;
+    if (m_data.size() - m_pos < payload_size)
+    {
+        throw std::runtime_error("Binary trace is truncated" + where);
+    }
+    const std::string_view payload = m_data.substr(m_pos, payload_size);
+    if (crc32(payload) != checksum)
+    {
+        throw std::runtime_error("Binary trace checksum mismatch" + where);
+    }
+    m_pos += payload_size;
+    m_block_index++;
+
+    if (count == 0)
+    {
+        m_done = true;
+        return false;
+    }
+
+    std::vector<uint32_t> dictionary(dictionary_size);
+    for (uint32_t i = 0; i < dictionary_size; i++)
+        dictionary[i] = get_u32(payload.data() + 4 * i);
+
+    std::array<ColumnReader, rvtb::column_count> columns;
+    std::size_t column_pos = std::size_t(dictionary_size) * 4;
+    for (std::size_t i = 0; i < rvtb::column_count; i++)
+    {
+        columns[i] = ColumnReader(payload.substr(column_pos, column_sizes[i]));
+        column_pos += column_sizes[i];
+    }
+
+    block.pcs.resize(count);
+    block.codes.resize(count);
+    m_state.next_pc = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint64_t pc = m_state.next_pc + unzigzag(columns[rvtb::PC].varint());
+        const uint64_t index = columns[rvtb::CODE].varint();
+        if (index >= dictionary_size)
+        {
+            throw std::runtime_error("Corrupt binary trace: bad dictionary index" + where);
+        }
+        block.pcs[i] = pc;
+        block.codes[i] = dictionary[index];
+        m_state.next_pc = fall_through_pc(pc, block.codes[i]);
+    }
+
+    if (!with_fields)
+        return true;
+
+    m_state.reset();
+    block.records.resize(count);
+    uint64_t run_left = 0;
+    uint16_t core = 0;
+    uint8_t priv = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        TraceRecord &record = block.records[i];
+        record.pc = block.pcs[i];
+        record.code = block.codes[i];
+
+        if (run_left == 0)
+        {
+            run_left = columns[rvtb::CONTEXT].varint();
+            core = static_cast<uint16_t>(columns[rvtb::CONTEXT].varint());
+            priv = columns[rvtb::CONTEXT].byte();
+        }
+        run_left--;
+        record.core = core;
+        record.priv = priv;
+
+        const uint8_t flags = columns[rvtb::FLAGS].byte();
+        record.reg_write_count = std::min<uint8_t>(flags & 0x7, TraceRecord::max_reg_writes);
+        record.mem_access_count = std::min<uint8_t>((flags >> 3) & 0x3, TraceRecord::max_mem_accesses);
+        record.truncated = flags & 0x80;
+
+        BinaryBlockState::PcHistory &history = m_state.by_pc[record.pc];
+        for (std::size_t r = 0; r < record.reg_write_count; r++)
+        {
+            const uint64_t reg = columns[rvtb::REGS].varint();
+            RegWrite &write = record.reg_writes[r];
+            write.file = static_cast<RegFile>(reg & 0x3);
+            write.num = static_cast<uint16_t>(reg >> 2);
+            uint64_t &last = m_state.last_reg[reg_slot(write.file, write.num)];
+            const uint64_t predicted = r < history.reg_write_count ? history.reg_values[r] : last;
+            write.value = predicted + unzigzag(columns[rvtb::REGS].varint());
+            last = write.value;
+            history.reg_values[r] = write.value;
+        }
+
+        for (std::size_t m = 0; m < record.mem_access_count; m++)
+        {
+            MemAccess &access = record.mem_accesses[m];
+            const bool seen = m < history.mem_access_count;
+            access.addr = (seen ? history.mem_addrs[m] : m_state.last_addr) + unzigzag(columns[rvtb::MEM].varint());
+            m_state.last_addr = access.addr;
+            history.mem_addrs[m] = access.addr;
+            access.store = flags & (0x20 << m);
+            access.data = access.store ? (seen ? history.mem_data[m] : 0) + unzigzag(columns[rvtb::MEM].varint()) : 0;
+            history.mem_data[m] = access.data;
+        }
+        history.reg_write_count = record.reg_write_count;
+        history.mem_access_count = record.mem_access_count;
+    }
+    return true;
+}
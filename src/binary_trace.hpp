@@ -0,0 +1,158 @@
+#ifndef BINARY_TRACE_HPP
+#define BINARY_TRACE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "line_parse.hpp"
+#include "output.hpp"
+
+// .rvtb: a spike commit log converted once into compact columns, so later
+// runs skip the text parsing. All integers are little endian.
+//
+//   file header  "RVTB", u16 version, u16 header size, u32 records per block,
+//                u32 reserved
+//   block        u32 record count, u32 dictionary size, u32 column sizes[6],
+//                u32 CRC-32 of the payload, then the payload: the dictionary
+//                (u32 instruction words) followed by the columns
+//   end          a block header with record count 0
+//
+// Columns are LEB128 varints unless noted; "zigzag" maps signed deltas to
+// small unsigned numbers:
+//   pc       zigzag difference to the fall-through pc of the previous record
+//   code     index of the instruction word in the block dictionary
+//   flags    one byte per record: register writes (bits 0-2), memory
+//            accesses (bits 3-4), store mask (bits 5-6), truncated (bit 7)
+//   context  runs of (length, core, privilege byte)
+//   regs     per write: number << 2 | register file, then the zigzag
+//            difference to the predicted value
+//   mem      per access: zigzag difference to the predicted address, then
+//            for stores the zigzag difference to the predicted value
+// Values are predicted from the previous execution of the same pc in the
+// block (the same write or access slot), which turns loop bodies into runs
+// of small deltas; a pc seen for the first time predicts the register's
+// last value and the previous address instead. Blocks start from zeroed
+// state, so each one decodes on its own.
+namespace rvtb
+{
+    inline constexpr char magic[4] = {'R', 'V', 'T', 'B'};
+    inline constexpr uint16_t version = 1;
+    inline constexpr std::size_t file_header_size = 16;
+    inline constexpr std::size_t column_count = 6;
+    inline constexpr std::size_t block_header_size = 4 * (3 + column_count);
+
+    enum Column
+    {
+        PC,
+        CODE,
+        FLAGS,
+        CONTEXT,
+        REGS,
+        MEM,
+    };
+}
+
+// True when data starts with the .rvtb magic number.
+bool is_binary_trace(std::string_view data);
+
+// Prediction state shared by the encoder and decoder of a block.
+struct BinaryBlockState
+{
+    // fields of the last execution of one pc
+    struct PcHistory
+    {
+        uint8_t reg_write_count = 0;
+        uint8_t mem_access_count = 0;
+        uint64_t reg_values[TraceRecord::max_reg_writes];
+        uint64_t mem_addrs[TraceRecord::max_mem_accesses];
+        uint64_t mem_data[TraceRecord::max_mem_accesses];
+    };
+
+    uint64_t next_pc = 0;
+    uint64_t last_addr = 0;
+    // indexed by RegFile * 4096 + register number
+    std::vector<uint64_t> last_reg = std::vector<uint64_t>(4 * 4096);
+    std::unordered_map<uint64_t, PcHistory> by_pc;
+
+    void reset();
+};
+
+class BinaryTraceWriter
+{
+private:
+    int m_fd;
+    OutputBuffer m_out;
+    uint32_t m_block_records;
+    uint32_t m_count = 0;
+    uint64_t m_total_records = 0;
+    uint64_t m_bytes_written = 0;
+    BinaryBlockState m_state;
+    std::unordered_map<uint32_t, uint32_t> m_dictionary;
+    std::vector<uint32_t> m_words;
+    std::array<std::string, rvtb::column_count> m_columns;
+    // current run of the context column
+    uint32_t m_run_length = 0;
+    uint16_t m_run_core = 0;
+    uint8_t m_run_priv = 0;
+    bool m_finished = false;
+
+    void flush_run();
+    void flush_block();
+
+public:
+    static constexpr uint32_t default_block_records = 1 << 16;
+
+    explicit BinaryTraceWriter(const std::string &file_name, uint32_t block_records = default_block_records);
+
+    ~BinaryTraceWriter();
+
+    BinaryTraceWriter(const BinaryTraceWriter &) = delete;
+    BinaryTraceWriter &operator=(const BinaryTraceWriter &) = delete;
+
+    void add(const TraceRecord &record);
+
+    // Writes the last block and the end marker. A writer destroyed without
+    // finish leaves a file the reader rejects as truncated.
+    void finish();
+
+    uint64_t get_record_count() const { return m_total_records; }
+
+    uint64_t get_bytes_written() const { return m_bytes_written; }
+};
+
+// One block of a binary trace. pcs and codes are always filled; records
+// only on request, since decoding the listing needs just the words.
+struct TraceBlock
+{
+    std::vector<uint64_t> pcs;
+    std::vector<uint32_t> codes;
+    std::vector<TraceRecord> records;
+};
+
+// Walks the blocks of a .rvtb file held in memory (normally a FileReader
+// mapping), checking each block's checksum before handing it out. Throws
+// std::runtime_error on a bad header, checksum or truncated file.
+class BinaryTraceReader
+{
+private:
+    std::string_view m_data;
+    std::size_t m_pos = 0;
+    std::size_t m_block_index = 0;
+    bool m_done = false;
+    BinaryBlockState m_state;
+
+public:
+    explicit BinaryTraceReader(std::string_view data);
+
+    bool read_block(TraceBlock &block, bool with_fields = false);
+
+    // bytes consumed so far, for progress reporting
+    std::size_t get_offset() const { return m_pos; }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef BIT_SCATTER_HPP
+#define BIT_SCATTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// Reference loop over a {to, from} map, only used to build the tables.
+template <const auto &BitMap>
+constexpr uint32_t scatter_bits_slow(uint32_t raw)
+{
+    uint32_t result = 0;
+    for (const auto &[to, from] : BitMap)
+        result |= ((raw >> from) & 0x1) << to;
+    return result;
+}
+
+// Compiled form of a {to, from} bit map like j_imm_bit_map: result bit `to`
+// is input bit `from`. Instead of looping over the map per immediate, the
+// permutation is applied either with one constexpr table lookup per input
+// byte, or, on CPUs with BMI2, with a pext/pdep pair per group of bits whose
+// order the map preserves.
+template <const auto &BitMap>
+class BitScatter
+{
+private:
+    static constexpr std::size_t input_bits = []
+    {
+        int highest = 0;
+        for (const auto &[to, from] : BitMap)
+            highest = std::max(highest, from);
+        return static_cast<std::size_t>(highest) + 1;
+    }();
+
+    static constexpr std::size_t input_bytes = (input_bits + 7) / 8;
+    static constexpr std::size_t map_size = std::tuple_size_v<std::remove_cvref_t<decltype(BitMap)>>;
+
+    static_assert(input_bits <= 32, "bit maps index a 32-bit word");
+
+    // lut[k][b]: the scattered bits of input byte k when it holds b
+    static constexpr auto lut = []
+    {
+        std::array<std::array<uint32_t, 256>, input_bytes> table{};
+        for (std::size_t k = 0; k < input_bytes; k++)
+            for (uint32_t b = 0; b < 256; b++)
+                table[k][b] = scatter_bits_slow<BitMap>(b << (8 * k));
+        return table;
+    }();
+
+    struct Group
+    {
+        uint32_t from_mask;
+        uint32_t to_mask;
+    };
+
+    // Order-preserving groups: walking the input bits upwards, the output
+    // bits of a group also go upwards, so pdep(pext(raw, from), to) is exact.
+    // First fit keeps the count at 2-4 groups for the RISC-V maps.
+    struct Groups
+    {
+        std::array<Group, map_size> groups{};
+        std::array<int, map_size> last_to{};
+        std::size_t count = 0;
+    };
+
+    static constexpr Groups groups = []
+    {
+        Groups result{};
+        for (std::size_t from = 0; from < input_bits; from++)
+        {
+            for (const auto &[to, map_from] : BitMap)
+            {
+                if (static_cast<std::size_t>(map_from) != from)
+                    continue;
+                std::size_t g = 0;
+                while (g < result.count && result.last_to[g] >= to)
+                    g++;
+                if (g == result.count)
+                    result.count++;
+                result.groups[g].from_mask |= 1u << from;
+                result.groups[g].to_mask |= 1u << to;
+                result.last_to[g] = to;
+            }
+        }
+        return result;
+    }();
+
+public:
+    static constexpr uint32_t scatter_lut(uint32_t raw)
+    {
+        uint32_t result = 0;
+        for (std::size_t k = 0; k < input_bytes; k++)
+            result |= lut[k][(raw >> (8 * k)) & 0xff];
+        return result;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    __attribute__((target("bmi2"))) static uint32_t scatter_bmi2(uint32_t raw)
+    {
+        uint32_t result = 0;
+        for (std::size_t g = 0; g < groups.count; g++)
+            result |= _pdep_u32(_pext_u32(raw, groups.groups[g].from_mask), groups.groups[g].to_mask);
+        return result;
+    }
+#endif
+};
+
+inline bool cpu_has_bmi2()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool supported = []
+    {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("bmi2") != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Applies BitMap to raw: result bit `to` = raw bit `from` for every pair.
+template <const auto &BitMap>
+inline uint32_t scatter_bits(uint32_t raw)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (cpu_has_bmi2())
+        return BitScatter<BitMap>::scatter_bmi2(raw);
+#endif
+    return BitScatter<BitMap>::scatter_lut(raw);
+}
+
+#endif
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "chunk_decoder.hpp"
+#include "line_parse.hpp"
+#include "instructions.hpp"
+#include "decoder.hpp"
+
+// Large enough to amortise the hand-off between threads, small enough that
+// jobs * 2 chunks of buffered output stay well within memory.
+static constexpr std::size_t chunk_size = 8 << 20;
+
+// lines per decode_batch call when decoding a chunk
+static constexpr std::size_t batch_size = 4096;
+
+void print_listing_line(const DecodedInstruction &inst, OutputBuffer &out, DecodeCounts &counts)
+{
+    out.write_hex(inst.code);
+    out.put(' ');
+    out << inst.mnemonic();
+    out.put(' ');
+    inst.print_payload(out);
+    out.put('\n');
+
+    if (inst.compressed)
+        counts.count_compressed++;
+    counts.count++;
+}
+
+void DecodeCounts::merge(const DecodeCounts &other)
+{
+    count += other.count;
+    count_compressed += other.count_compressed;
+    bad_lines += other.bad_lines;
+    filtered += other.filtered;
+    unknown.merge(other.unknown);
+}
+
+void fail_line(DecodeStatus status, uint32_t code, std::string_view line)
+{
+    throw std::runtime_error(decode_status_message(status, code) + "\n  in line: " + std::string(line));
+}
+
+void decode_line(std::string_view line, const DecodeConfig &config, OutputBuffer &out, DecodeCounts &counts,
+                 DecodeCache *cache)
+{
+    uint32_t code;
+    if (!try_extract_instruction_from_line(line, code))
+    {
+        if (config.strict)
+            fail_line(DecodeStatus::NO_INSTRUCTION, 0, line);
+        counts.bad_lines++;
+        return;
+    }
+    if (config.rejects_line(code, line))
+    {
+        counts.filtered++;
+        return;
+    }
+
+    DecodedInstruction inst{};
+    DecodeStatus status = cache ? cache->decode(code, inst) : config.decoder->try_decode(code, inst);
+    if (status != DecodeStatus::OK)
+    {
+        if (config.strict)
+            fail_line(status, code, line);
+        counts.unknown.record(code);
+    }
+
+    print_listing_line(inst, out, counts);
+}
+
+static void decode_lines(std::string_view lines, const DecodeConfig &config, OutputBuffer &out, DecodeCounts &counts,
+                         DecodeCache *cache)
+{
+    while (!lines.empty())
+    {
+        std::size_t eol = lines.find('\n');
+        std::string_view line = lines.substr(0, eol);
+        decode_line(line, config, out, counts, cache);
+        if (eol == std::string_view::npos)
+            break;
+        lines.remove_prefix(eol + 1);
+    }
+}
+
+void decode_chunk(std::string_view chunk, const DecodeConfig &config, OutputBuffer &out, DecodeCounts &counts,
+                  DecodeCache *cache)
+{
+    if (cache)
+    {
+        decode_lines(chunk, config, out, counts, cache);
+        return;
+    }
+
+    std::vector<std::string_view> lines;
+    std::vector<uint32_t> codes;
+    lines.reserve(batch_size);
+    codes.reserve(batch_size);
+    std::vector<DecodedInstruction> insts(batch_size);
+
+    while (!chunk.empty())
+    {
+        lines.clear();
+        codes.clear();
+        // a line without an instruction ends the batch early so that
+        // everything before it is listed first
+        std::string_view bad_line;
+        bool has_bad_line = false;
+        while (!chunk.empty() && codes.size() < batch_size)
+        {
+            std::size_t eol = chunk.find('\n');
+            std::string_view line = chunk.substr(0, eol);
+            chunk.remove_prefix(eol == std::string_view::npos ? chunk.size() : eol + 1);
+            uint32_t code;
+            if (!try_extract_instruction_from_line(line, code))
+            {
+                bad_line = line;
+                has_bad_line = true;
+                break;
+            }
+            if (config.rejects_line(code, line))
+            {
+                counts.filtered++;
+                continue;
+            }
+            lines.push_back(line);
+            codes.push_back(code);
+        }
+
+        const std::size_t unknown = config.decoder->decode_batch(codes, insts);
+        for (std::size_t i = 0; i < codes.size(); i++)
+        {
+            if (unknown && !insts[i].is_known())
+            {
+                if (config.strict)
+                    fail_line(DecodeStatus::UNKNOWN_ENCODING, codes[i], lines[i]);
+                counts.unknown.record(codes[i]);
+            }
+            print_listing_line(insts[i], out, counts);
+        }
+
+        if (has_bad_line)
+        {
+            if (config.strict)
+                fail_line(DecodeStatus::NO_INSTRUCTION, 0, bad_line);
+            counts.bad_lines++;
+        }
+    }
+}
+
+std::vector<std::size_t> split_into_chunks(std::string_view data)
+{
+    std::vector<std::size_t> bounds{0};
+    while (bounds.back() < data.size())
+    {
+        std::size_t next = bounds.back() + chunk_size;
+        if (next >= data.size())
+        {
+            bounds.push_back(data.size());
+            break;
+        }
+        std::size_t eol = data.find('\n', next - 1);
+        bounds.push_back(eol == std::string_view::npos ? data.size() : eol + 1);
+    }
+    return bounds;
+}
+
+struct ChunkSlot
+{
+    std::string output;
+    DecodeCounts counts;
+    std::exception_ptr error;
+    bool ready = false;
+};
+
+void decode_parallel(std::string_view data, const DecodeConfig &config, unsigned jobs, bool use_cache,
+                     OutputBuffer &out, DecodeCounts &counts, const progress_callback_t &progress)
+{
+    const std::vector<std::size_t> bounds = split_into_chunks(data);
+    const std::size_t chunk_count = bounds.size() - 1;
+    // bounds how far workers may run ahead of the in-order writer
+    const std::size_t window = 2 * static_cast<std::size_t>(jobs);
+
+    std::vector<ChunkSlot> slots(window);
+    std::mutex mutex;
+    std::condition_variable slot_free;
+    std::condition_variable slot_ready;
+    std::atomic<std::size_t> next_chunk{0};
+    std::size_t written = 0;
+    bool stop = false;
+
+    auto worker = [&]()
+    {
+        std::unique_ptr<DecodeCache> cache = use_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+        auto merge_cache_counts = [&]()
+        {
+            if (!cache)
+                return;
+            std::lock_guard lock(mutex);
+            counts.cache_hits += cache->get_hits();
+            counts.cache_misses += cache->get_misses();
+        };
+
+        for (;;)
+        {
+            std::size_t idx = next_chunk.fetch_add(1);
+            if (idx >= chunk_count)
+            {
+                merge_cache_counts();
+                return;
+            }
+
+            ChunkSlot &slot = slots[idx % window];
+            {
+                std::unique_lock lock(mutex);
+                slot_free.wait(lock, [&]
+                               { return stop || idx < written + window; });
+                if (stop)
+                {
+                    lock.unlock();
+                    merge_cache_counts();
+                    return;
+                }
+            }
+
+            OutputBuffer chunk_out;
+            DecodeCounts chunk_counts;
+            std::exception_ptr error;
+            try
+            {
+                decode_chunk(data.substr(bounds[idx], bounds[idx + 1] - bounds[idx]), config, chunk_out, chunk_counts,
+                             cache.get());
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                slot.output = chunk_out.release();
+                slot.counts = chunk_counts;
+                slot.error = error;
+                slot.ready = true;
+            }
+            slot_ready.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < jobs; i++)
+        threads.emplace_back(worker);
+
+    auto stop_workers = [&]()
+    {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        slot_free.notify_all();
+        for (auto &thread : threads)
+            thread.join();
+    };
+
+    for (std::size_t idx = 0; idx < chunk_count; idx++)
+    {
+        ChunkSlot &slot = slots[idx % window];
+        std::string output;
+        std::exception_ptr error;
+        {
+            std::unique_lock lock(mutex);
+            slot_ready.wait(lock, [&]
+                            { return slot.ready; });
+            output = std::move(slot.output);
+            counts.merge(slot.counts);
+            error = slot.error;
+            slot = ChunkSlot{};
+            written++;
+        }
+        slot_free.notify_all();
+
+        out.write(output);
+        if (error)
+        {
+            // same as the serial path: everything before the bad line is kept
+            stop_workers();
+            std::rethrow_exception(error);
+        }
+
+        if (progress)
+            progress(bounds[idx + 1]);
+    }
+
+    stop_workers();
+}
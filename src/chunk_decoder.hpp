@@ -0,0 +1,76 @@
+#ifndef CHUNK_DECODER_HPP
+#define CHUNK_DECODER_HPP
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "output.hpp"
+#include "decode_cache.hpp"
+#include "decoder.hpp"
+#include "decode_status.hpp"
+#include "instruction_filter.hpp"
+
+struct DecodeCounts
+{
+    std::size_t count = 0;
+    std::size_t count_compressed = 0;
+    std::size_t cache_hits = 0;
+    std::size_t cache_misses = 0;
+    // lines without an instruction code, skipped unless strict
+    std::size_t bad_lines = 0;
+    // instructions the filter rejected; they are not in count
+    std::size_t filtered = 0;
+    UnknownHistogram unknown;
+
+    // adds everything but the cache counters, which workers report themselves
+    void merge(const DecodeCounts &other);
+};
+
+struct DecodeConfig
+{
+    const IsaDecoder *decoder;
+    // stop at the first unknown encoding or bad line instead of counting it
+    bool strict = false;
+    // only instructions it accepts are decoded and listed; null lists all
+    const InstructionFilter *filter = nullptr;
+
+    bool rejects_line(uint32_t code, std::string_view line) const
+    {
+        return filter && !filter->accepts_line(code, line, *decoder);
+    }
+};
+
+// Writes the listing entry of one decoded instruction and counts it.
+void print_listing_line(const DecodedInstruction &inst, OutputBuffer &out, DecodeCounts &counts);
+
+// Throws the strict-mode error for a line that failed with status.
+[[noreturn]] void fail_line(DecodeStatus status, uint32_t code, std::string_view line);
+
+// Decodes one trace line and writes its listing entry to out. Unknown
+// encodings are listed as UNKNOWN and recorded in counts.unknown; with
+// config.strict they throw instead. cache may be null to decode every
+// instruction from scratch; otherwise it must have been created for the
+// same decoder.
+void decode_line(std::string_view line, const DecodeConfig &config, OutputBuffer &out, DecodeCounts &counts,
+                 DecodeCache *cache);
+
+// Decodes every line of a newline-aligned block of the trace.
+void decode_chunk(std::string_view chunk, const DecodeConfig &config, OutputBuffer &out, DecodeCounts &counts,
+                  DecodeCache *cache);
+
+// Chunk boundaries for the parallel paths: offsets of newline-aligned
+// chunks of about 8 MiB, starting with 0 and ending with data.size().
+std::vector<std::size_t> split_into_chunks(std::string_view data);
+
+using progress_callback_t = std::function<void(std::size_t offset)>;
+
+// Splits data into newline-aligned chunks, decodes them on jobs threads and
+// writes the listing to out in the original line order. The output is
+// identical to calling decode_line on every line in turn. With use_cache
+// every thread keeps its own DecodeCache.
+void decode_parallel(std::string_view data, const DecodeConfig &config, unsigned jobs, bool use_cache,
+                     OutputBuffer &out, DecodeCounts &counts, const progress_callback_t &progress);
+
+#endif
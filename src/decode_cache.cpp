@@ -0,0 +1,31 @@
+#include "decode_cache.hpp"
+
+DecodeCache::DecodeCache(const IsaDecoder &decoder, unsigned bits)
+    : m_decoder(decoder), m_entries(std::size_t(1) << bits), m_shift(32 - bits)
+{
+}
+
+DecodeStatus DecodeCache::decode(uint32_t code, DecodedInstruction &inst)
+{
+    if ((code & 0x03) != 3)
+        return m_decoder.try_decode(code, inst);
+
+    // Fibonacci hashing spreads the opcode bits in the low byte over the index
+    Entry &entry = m_entries[(code * 0x9e3779b1u) >> m_shift];
+    if (entry.valid && entry.code == code)
+    {
+        m_hits++;
+        inst = entry.inst;
+        return DecodeStatus::OK;
+    }
+
+    m_misses++;
+    DecodeStatus status = m_decoder.try_decode(code, inst);
+    if (status == DecodeStatus::OK)
+    {
+        entry.code = code;
+        entry.inst = inst;
+        entry.valid = true;
+    }
+    return status;
+}
@@ -0,0 +1,44 @@
+#ifndef DECODE_CACHE_HPP
+#define DECODE_CACHE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "instructions.hpp"
+#include "decoder.hpp"
+
+// Direct-mapped memo of fully decoded uncompressed instructions keyed by
+// the instruction word. Loops execute the same few words over and over, so
+// nearly every lookup is a hit. Compressed words skip the cache because the
+// 64K compressed table already is one.
+class DecodeCache
+{
+private:
+    struct Entry
+    {
+        uint32_t code;
+        bool valid;
+        DecodedInstruction inst;
+    };
+
+    const IsaDecoder &m_decoder;
+    std::vector<Entry> m_entries;
+    uint32_t m_shift;
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+
+public:
+    static constexpr unsigned default_bits = 12;
+
+    explicit DecodeCache(const IsaDecoder &decoder, unsigned bits = default_bits);
+
+    // same contract as decoder.try_decode; unknown words are not cached
+    DecodeStatus decode(uint32_t code, DecodedInstruction &inst);
+
+    std::size_t get_hits() const { return m_hits; }
+
+    std::size_t get_misses() const { return m_misses; }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "decode_status.hpp"
+#include "utils.hpp"
+
+std::string decode_status_message(DecodeStatus status, uint32_t code)
+{
+    switch (status)
+    {
+    case DecodeStatus::OK:
+        return "OK";
+    case DecodeStatus::UNKNOWN_ENCODING:
+        return "Unknown instruction encoding " + uint32_t_to_hex(code);
+    case DecodeStatus::NO_INSTRUCTION:
+        return "Cannot find instruction code in input line.";
+    }
+    return "Unknown decode status";
+}
+
+void UnknownHistogram::merge(const UnknownHistogram &other)
+{
+    for (std::size_t key = 0; key < key_count; key++)
+    {
+        if (m_entries[key].count == 0)
+            m_entries[key].example = other.m_entries[key].example;
+        m_entries[key].count += other.m_entries[key].count;
+    }
+    m_total += other.m_total;
+}
+
+void UnknownHistogram::report(std::ostream &os) const
+{
+    std::vector<std::size_t> keys;
+    for (std::size_t key = 0; key < key_count; key++)
+        if (m_entries[key].count)
+            keys.push_back(key);
+    std::stable_sort(keys.begin(), keys.end(), [&](std::size_t a, std::size_t b)
+                     { return m_entries[a].count > m_entries[b].count; });
+
+    os << "unknown encodings: " << m_total << "\n";
+    for (std::size_t key : keys)
+    {
+        const Entry &entry = m_entries[key];
+        if (key < uncompressed_keys)
+            os << "  opcode 0x" << std::hex << ((key & 0x1f) << 2 | 0x3) << std::dec << " funct3 " << (key >> 5);
+        else
+            os << "  quadrant " << ((key - uncompressed_keys) & 0x3) << " funct3 " << ((key - uncompressed_keys) >> 2);
+        const int digits = key < uncompressed_keys ? 8 : 4;
+        os << ": " << entry.count << " (first 0x" << std::hex << std::uppercase << std::setw(digits)
+           << std::setfill('0') << entry.example << std::dec << std::nouppercase << std::setfill(' ') << ")\n";
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef DECODE_STATUS_HPP
+#define DECODE_STATUS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+enum class DecodeStatus : uint8_t
+{
+    OK,
+    // the word matches no pattern of the selected ISA
+    UNKNOWN_ENCODING,
+    // the trace line has no "(0x...)" instruction code
+    NO_INSTRUCTION,
+};
+
+// message the strict mode raises for a failed status
+std::string decode_status_message(DecodeStatus status, uint32_t code);
+
+// Counts of unknown encodings keyed by major opcode and funct3 (quadrant
+// and funct3 for compressed words), with the first word seen for each key
+// so the report can be checked against a disassembler.
+class UnknownHistogram
+{
+private:
+    static constexpr std::size_t uncompressed_keys = 256;
+    static constexpr std::size_t key_count = uncompressed_keys + 32;
+
+    struct Entry
+    {
+        uint64_t count = 0;
+        uint32_t example = 0;
+    };
+
+    std::array<Entry, key_count> m_entries{};
+    uint64_t m_total = 0;
+
+    static std::size_t key_of(uint32_t code)
+    {
+        if ((code & 0x3) == 0x3)
+            return ((code >> 2) & 0x1f) | ((code >> 12) & 0x7) << 5;
+        return uncompressed_keys + ((code & 0x3) | ((code >> 13) & 0x7) << 2);
+    }
+
+public:
+    void record(uint32_t code, uint64_t count = 1)
+    {
+        Entry &entry = m_entries[key_of(code)];
+        if (entry.count == 0)
+            entry.example = code;
+        entry.count += count;
+        m_total += count;
+    }
+
+    void merge(const UnknownHistogram &other);
+
+    uint64_t get_total() const { return m_total; }
+
+    // one line per key, most frequent first
+    void report(std::ostream &os) const;
+};
+
+#endif
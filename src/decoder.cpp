@@ -1,10 +1,19 @@
 #include "decoder.hpp"
+#include "inst_table.hpp"
 #include "utils.hpp"
 
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <stdexcept>
+#include <array>
+#include <memory>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 inline bool
 is_instruction_compressed(uint32_t code)
@@ -17,1044 +26,417 @@ void decode_compressed_operands(uint32_t code, DecodedInstruction &inst)
     switch (inst.format)
     {
     case InstFormat::CR:
-        inst.payload = CRTypeFields(
-            (uint8_t)MASK(code, bitmask_11_7),
-            (uint8_t)MASK(code, bitmask_6_2));
+        inst.rd = MASK(code, bitmask_11_7);
+        inst.rs2 = MASK(code, bitmask_6_2);
         break;
     case InstFormat::CI:
     {
         uint8_t upper = MASK(code, bitmask_12);
         uint8_t lower = MASK(code, bitmask_6_2);
+        inst.rd = MASK(code, bitmask_11_7);
 
         if (inst.name == C_ADDI16SP)
         {
             uint16_t immediate = ((upper << 5) | lower);
-            immediate = extract_offset<decltype(addi16sp_imm_bit_map)>(immediate, addi16sp_imm_bit_map);
-
-            int32_t imm_mapped = sign_extend_addi16sp(immediate, 10);
-
-            // std::cout << "mapped: " << imm_mapped << std::endl;
-            inst.payload = CITypeFields(
-                (uint8_t)MASK(code, bitmask_12),
-                (uint8_t)MASK(code, bitmask_11_7),
-                (uint8_t)MASK(code, bitmask_6_2),
-                imm_mapped);
+            immediate = scatter_bits<addi16sp_imm_bit_map>(immediate);
+            inst.imm = sign_extend_addi16sp(immediate, 10);
             break;
         }
 
         uint8_t immediate = (upper << 5) | lower;
-        inst.payload = CITypeFields(
-            (uint8_t)MASK(code, bitmask_12),
-            (uint8_t)MASK(code, bitmask_11_7),
-            (uint8_t)MASK(code, bitmask_6_2),
-            sign_extend(immediate, 6));
+        inst.imm = sign_extend(immediate, 6);
     }
     break;
     case InstFormat::CSS:
-    {
-        int32_t immediate = (uint8_t)MASK(code, bitmask_12_7) << 3;
-        inst.payload = CSSTypeFields(
-            (uint8_t)MASK(code, bitmask_12_7),
-            (uint8_t)MASK(code, bitmask_6_2),
-            immediate);
-    }
-    break;
+        inst.rs2 = MASK(code, bitmask_6_2);
+        inst.imm = (uint8_t)MASK(code, bitmask_12_7) << 3;
+        break;
     case InstFormat::CIW:
-        inst.payload = CIWTypeFields(
-            (uint8_t)MASK(code, bitmask_12_5),
-            (uint8_t)MASK(code, bitmask_4_2));
+        inst.rd = MASK(code, bitmask_4_2);
+        inst.imm = (uint8_t)MASK(code, bitmask_12_5);
         break;
     case InstFormat::CL:
-        inst.payload = CLTypeFields(
-            (uint8_t)MASK(code, bitmask_12_10),
-            (uint8_t)MASK(code, bitmask_9_7),
-            (uint8_t)MASK(code, bitmask_6_5),
-            (uint8_t)MASK(code, bitmask_4_2));
+        inst.rs1 = MASK(code, bitmask_9_7);
+        inst.rd = MASK(code, bitmask_4_2);
         break;
     case InstFormat::CS:
-        inst.payload = CSTypeFields(
-            (uint8_t)MASK(code, bitmask_12_10),
-            (uint8_t)MASK(code, bitmask_9_7),
-            (uint8_t)MASK(code, bitmask_6_5),
-            (uint8_t)MASK(code, bitmask_4_2));
+        inst.rs1 = MASK(code, bitmask_9_7);
+        inst.rs2 = MASK(code, bitmask_4_2);
         break;
     case InstFormat::CA:
-        inst.payload = CATypeFields(
-            (uint8_t)MASK(code, bitmask_9_7),
-            (uint8_t)MASK(code, bitmask_4_2));
+        inst.rd = MASK(code, bitmask_9_7);
+        inst.rs2 = MASK(code, bitmask_4_2);
         break;
     case InstFormat::CB:
     {
         uint8_t upper = MASK(code, bitmask_12_10);
-        uint8_t rd_rs1 = MASK(code, bitmask_9_7);
         uint8_t lower = MASK(code, bitmask_6_2);
-        inst.payload = CBTypeFields(
-            (uint8_t)upper,
-            (uint8_t)rd_rs1,
-            (uint8_t)lower);
+        inst.rd = MASK(code, bitmask_9_7);
+        inst.imm = 0;
 
         if (inst.name == C_BEQZ || inst.name == C_BNEZ)
         {
             uint8_t offset = upper << 5;
             offset |= lower;
 
-            inst.payload = CBTypeFields(upper, (uint8_t)MASK(code, bitmask_9_7), lower,
-                                        sign_extend(extract_offset<decltype(c_b_offset_bit_map)>(offset, c_b_offset_bit_map), 8));
+            // offset[8:1], so the sign is bit 8
+            inst.imm = sign_extend(scatter_bits<c_b_offset_bit_map>(offset), 9);
         }
     }
     break;
     case InstFormat::CJ:
-        inst.payload = CJTypeFields(
-            (uint16_t)MASK(code, bitmask_12_2));
-
-        if (inst.name == C_J)
-        {
-            std::cout << uint32_t_to_dec_hex_bin(MASK(code, bitmask_12_2)) << std::endl;
-
-            uint32_t offset_raw = (uint32_t)MASK(code, bitmask_12_2);
-            uint16_t offset = extract_offset<decltype(c_j_offset_bit_map)>(offset_raw, c_j_offset_bit_map);
-
-            inst.payload = CJTypeFields(offset, sign_extend(offset, 12));
-        }
-        break;
+    {
+        uint32_t offset_raw = (uint32_t)MASK(code, bitmask_12_2);
+        uint16_t offset = scatter_bits<c_j_offset_bit_map>(offset_raw);
+        inst.imm = sign_extend(offset, 12);
+    }
+    break;
     default:
-        throw std::runtime_error("Encountered unhandled instruction format in switch case.");
+        break;
     }
 }
 
-void decode_compressed(uint32_t code, DecodedInstruction &inst)
+void decode_common_instruction_operands(uint32_t code, DecodedInstruction &inst)
 {
-    const uint32_t masked_lower = MASK(code, bitmask_1_0);
-    const uint32_t masked_upper = MASK(code, bitmask_15_13);
+    const uint8_t bits_31_27 = MASK(code, bitmask_31_27);
+    const uint8_t bits_30_25 = MASK(code, bitmask_30_25);
+    const uint8_t bits_24_20 = MASK(code, bitmask_24_20);
+    const uint8_t bits_19_15 = MASK(code, bitmask_19_15);
+    const uint8_t bits_11_7 = MASK(code, bitmask_11_7);
+    const uint16_t bits_31_20 = MASK(code, bitmask_31_20);
+    const uint8_t bits_11_8 = MASK(code, bitmask_11_8);
+    const uint8_t bits_7 = MASK(code, bitmask_7);
+    const uint32_t bits_31_12 = MASK(code, bitmask_31_12);
 
-    switch (masked_lower)
+    switch (inst.format)
     {
-    case 0x0:
-        switch (masked_upper)
-        {
-        case 0x0:
-            inst.name = C_ADDI4SPN;
-            inst.mnemonic = insts_mnem_map[C_ADDI4SPN];
-            inst.format = InstFormat::CIW;
-            break;
-        case 0x1:
-            inst.name = C_FLD;
-            inst.mnemonic = insts_mnem_map[C_FLD];
-            inst.format = InstFormat::CL;
-            break;
-        case 0x2:
-            inst.name = C_LW;
-            inst.mnemonic = insts_mnem_map[C_LW];
-            inst.format = InstFormat::CL;
-            break;
-        case 0x3:
-            // FLW is RV32 only (omitted)
-            inst.name = C_LD;
-            inst.mnemonic = insts_mnem_map[C_LD];
-            inst.format = InstFormat::CL;
-            break;
-        case 0x4:
-            // reserved
-            throw std::runtime_error("Encountered reserved opcode");
-            break;
-        case 0x5:
-            inst.name = C_FSD;
-            inst.mnemonic = insts_mnem_map[C_FSD];
-            inst.format = InstFormat::CS;
-            break;
-        case 0x6:
-            inst.name = C_SW;
-            inst.mnemonic = insts_mnem_map[C_SW];
-            inst.format = InstFormat::CS;
-            break;
-        case 0x7:
-            // FSW is RV32 only (omitted)
-            inst.name = C_SD;
-            inst.mnemonic = insts_mnem_map[C_SD];
-            inst.format = InstFormat::CS;
-            break;
-        default:
-            throw std::runtime_error("Encountered undefined switch case");
-            break;
-        }
+    case InstFormat::R:
+        inst.rs2 = bits_24_20;
+        inst.rs1 = bits_19_15;
+        inst.rd = bits_11_7;
         break;
-    case 0x1:
-        switch (masked_upper)
-        {
-        case 0x0:
-            if (MASK(code, bitmask_11_7))
-            {
-                inst.name = C_ADDI;
-                inst.mnemonic = insts_mnem_map[C_ADDI];
-                inst.format = InstFormat::CI;
-            }
-            else
-            {
-                inst.name = C_NOP;
-                inst.mnemonic = insts_mnem_map[C_NOP];
-                inst.format = InstFormat::CI;
-            }
-            break;
-        case 0x1:
-            // JAL is RV32 only (omitted)
-            inst.name = C_ADDIW;
-            inst.mnemonic = insts_mnem_map[C_ADDIW];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x2:
-            inst.name = C_LI;
-            inst.mnemonic = insts_mnem_map[C_LI];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x3:
-            if (MASK(code, bitmask_11_7) == 0x2)
-            {
-                inst.name = C_ADDI16SP;
-                inst.mnemonic = insts_mnem_map[C_ADDI16SP];
-                inst.format = InstFormat::CI;
-            }
-            else if (MASK(code, bitmask_11_7) != 0x0 && (MASK(code, bitmask_11_7) != 0x2))
-            {
-                inst.name = C_LUI;
-                inst.mnemonic = insts_mnem_map[C_LUI];
-                inst.format = InstFormat::CI;
-            }
-            else
-            {
-                throw std::runtime_error("Encountered undefined switch case");
-            }
-            break;
-        case 0x4:
-            switch (MASK(code, bitmask_11_10))
-            {
-            case 0x0:
-                inst.name = C_SRLI;
-                inst.mnemonic = insts_mnem_map[C_SRLI];
-                inst.format = InstFormat::CB;
-                break;
-            case 0x1:
-                inst.name = C_SRAI;
-                inst.mnemonic = insts_mnem_map[C_SRAI];
-                inst.format = InstFormat::CB;
-                break;
-            case 0x2:
-                inst.name = C_ANDI;
-                inst.mnemonic = insts_mnem_map[C_ANDI];
-                inst.format = InstFormat::CB;
-                break;
-            case 0x3:
-                inst.format = InstFormat::CA;
-                switch (MASK(code, bitmask_6_5))
-                {
-                case 0x0:
-                    inst.name = C_SUB;
-                    inst.mnemonic = insts_mnem_map[C_SUB];
-                    break;
-                case 0x1:
-                    inst.name = C_XOR;
-                    inst.mnemonic = insts_mnem_map[C_XOR];
-                    break;
-                case 0x2:
-                    inst.name = C_OR;
-                    inst.mnemonic = insts_mnem_map[C_OR];
-                    break;
-                case 0x3:
-                    inst.name = C_AND;
-                    inst.mnemonic = insts_mnem_map[C_AND];
-                    break;
-                default:
-                    throw std::runtime_error("Encountered undefined switch case");
-                    break;
-                }
-                break;
-            default:
-                throw std::runtime_error("Encountered undefined switch case");
-                break;
-            }
-            break;
-        case 0x5:
-            inst.name = C_J;
-            inst.mnemonic = insts_mnem_map[C_J];
-            inst.format = InstFormat::CJ;
-            break;
-        case 0x6:
-            inst.name = C_BEQZ;
-            inst.mnemonic = insts_mnem_map[C_BEQZ];
-            inst.format = InstFormat::CB;
-            break;
-        case 0x7:
-            inst.name = C_BNEZ;
-            inst.mnemonic = insts_mnem_map[C_BNEZ];
-            inst.format = InstFormat::CB;
-            break;
-        default:
-            break;
-        }
+    case InstFormat::R_4:
+        inst.rs3 = bits_31_27;
+        inst.rs2 = bits_24_20;
+        inst.rs1 = bits_19_15;
+        inst.rd = bits_11_7;
         break;
-    case 0x2:
-        switch (masked_upper)
-        {
-        case 0x0:
-            inst.name = C_SLLI;
-            inst.mnemonic = insts_mnem_map[C_SLLI];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x1:
-            inst.name = C_FLDSP;
-            inst.mnemonic = insts_mnem_map[C_FLDSP];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x2:
-            inst.name = C_LWSP;
-            inst.mnemonic = insts_mnem_map[C_LWSP];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x3:
-            // FLWSP is RV32 only (omitted)
-            inst.name = C_LDSP;
-            inst.mnemonic = insts_mnem_map[C_LDSP];
-            inst.format = InstFormat::CI;
-            break;
-        case 0x4:
-            if (MASK(code, bitmask_12))
-            {
-                if ((MASK(code, bitmask_11_7)) == 0x0 && (MASK(code, bitmask_6_2)) == 0x0)
-                {
-                    inst.name = C_EBREAK;
-                    inst.mnemonic = insts_mnem_map[C_EBREAK];
-                    inst.format = InstFormat::CR;
-                    break;
-                }
-
-                if (!(MASK(code, bitmask_11_7)))
-                {
-                    std::cout << inst.line << std::endl;
-                    throw std::runtime_error("Illegal operands for instruction (C.ADD/C.JALR): " + std::to_string(code));
-                }
-
-                if (MASK(code, bitmask_6_2))
-                {
-                    inst.name = C_ADD;
-                    inst.mnemonic = insts_mnem_map[C_ADD];
-                    inst.format = InstFormat::CR;
-                }
-                else
-                {
-                    inst.name = C_JALR;
-                    inst.mnemonic = insts_mnem_map[C_JALR];
-                    inst.format = InstFormat::CA;
-                }
-            }
-            else
-            {
-                if (MASK(code, bitmask_6_2))
-                {
-                    inst.name = C_MV;
-                    inst.mnemonic = insts_mnem_map[C_MV];
-                    inst.format = InstFormat::CR;
-                }
-                else
-                {
-                    inst.name = C_JR;
-                    inst.mnemonic = insts_mnem_map[C_JR];
-                    inst.format = InstFormat::CR;
-                }
-            }
-            break;
-        case 0x5:
-            inst.name = C_FSDSP;
-            inst.mnemonic = insts_mnem_map[C_FSDSP];
-            inst.format = InstFormat::CSS;
-            break;
-        case 0x6:
-            inst.name = C_SWSP;
-            inst.mnemonic = insts_mnem_map[C_SWSP];
-            inst.format = InstFormat::CSS;
-            break;
-        case 0x7:
-            // FSWSP is RV32 only (omitted)
-            inst.name = C_SDSP;
-            inst.mnemonic = insts_mnem_map[C_SDSP];
-            inst.format = InstFormat::CSS;
-            break;
-        default:
-            throw std::runtime_error("Encountered undefined switch case");
-            break;
-        }
+    case InstFormat::I:
+        // printed as the raw unsigned 12-bit field
+        inst.imm = bits_31_20;
+        inst.rs1 = bits_19_15;
+        inst.rd = bits_11_7;
+        break;
+    case InstFormat::S:
+        inst.rs2 = bits_24_20;
+        inst.rs1 = bits_19_15;
+        inst.imm = sign_extend((MASK(code, bitmask_31_25) << 5) | bits_11_7, 12);
+        break;
+    case InstFormat::B:
+    {
+        uint16_t immediate = (((bits_30_25 << 4) | bits_11_8) << 1) | bits_7;
+        inst.rs2 = bits_24_20;
+        inst.rs1 = bits_19_15;
+        inst.imm = (int16_t)sign_extend(scatter_bits<b_offset_bit_map>(immediate), 12);
+    }
+    break;
+    case InstFormat::U:
+        inst.imm = bits_31_12;
+        inst.rd = bits_11_7;
+        break;
+    case InstFormat::J:
+        inst.rd = bits_11_7;
+        inst.imm = sign_extend(scatter_bits<j_imm_bit_map>(bits_31_12), 20);
         break;
     default:
-        throw std::runtime_error("Encountered undefined switch case");
         break;
     }
+}
 
-    decode_compressed_operands(code, inst);
-
-    return;
+void decode_vector_operands(uint32_t code, DecodedInstruction &inst)
+{
+    switch (inst.format)
+    {
+    case InstFormat::OPIVV:
+    case InstFormat::OPFVV:
+    case InstFormat::OPMVV:
+    case InstFormat::OPIVI:
+    case InstFormat::OPIVX:
+    case InstFormat::OPFVF:
+    case InstFormat::OPMVX:
+        inst.rs2 = MASK(code, bitmask_24_20);
+        inst.rs1 = MASK(code, bitmask_19_15);
+        inst.rd = MASK(code, bitmask_11_7);
+        break;
+    default:
+        break;
+    }
 }
 
-void decode_vector_op_v_instruction(uint32_t code, DecodedInstruction &inst)
+// Looks the word up in the patterns of Isa and fills in name, format and
+// the operand fields of the matched format. Unknown encodings are left as
+// UNKNOWN/InstFormat::UNKNOWN and return false. Words that only match a
+// format catch-all (name UNKNOWN) get their operands but return false too.
+template <uint32_t Isa>
+static bool decode_pattern(uint32_t code, DecodedInstruction &inst)
 {
-    uint32_t code_14_12 = MASK(code, bitmask_14_12);
-    uint32_t code_31_10 = MASK(code, bitmask_31_30);
+    const InstPattern *pattern = PatternDecoder<isa_patterns<Isa>>::match(code);
+    if (pattern == nullptr || pattern->is_reject())
+    {
+        inst.name = UNKNOWN;
+        inst.format = InstFormat::UNKNOWN;
+        return false;
+    }
 
-    if (code_14_12 == 0x7)
+    inst.name = pattern->name;
+    inst.format = pattern->format;
+    if (inst.compressed)
     {
-        // OPCFG scalar-imms
-        inst.format = InstFormat::OPCFG;
-        switch (code_31_10)
-        {
-        case 0x0:
-            inst.name = V_VSETVLI;
-            inst.mnemonic = insts_mnem_map[V_VSETVLI];
-            break;
-        case 0x1:
-            inst.name = V_VSETVLI;
-            inst.mnemonic = insts_mnem_map[V_VSETVLI];
-            break;
-        case 0x2:
-            inst.name = V_VSETVL;
-            inst.mnemonic = insts_mnem_map[V_VSETVL];
-            break;
-        case 0x3:
-            inst.name = V_VSETIVLI;
-            inst.mnemonic = insts_mnem_map[V_VSETIVLI];
-            break;
-        default:
-            throw std::runtime_error("Encountered undefined switch case");
-            break;
-        }
+        decode_compressed_operands(code, inst);
     }
     else
     {
-        const uint8_t upper = MASK(code, bitmask_24_20);
-        const uint8_t middle = MASK(code, bitmask_19_15);
-        const uint8_t lower = MASK(code, bitmask_11_7);
-        switch (code_14_12)
-        {
-        case 0x0:
-            // OPIVV vector-vector
-            inst.format = InstFormat::OPIVV;
-            inst.payload = OPIVVTypeFields(upper, middle, lower);
-            break;
-        case 0x1:
-            // OPFVV vector-vector
-            inst.format = InstFormat::OPFVV;
-            inst.payload = OPFVVTypeFields(upper, middle, lower);
-            break;
-        case 0x2:
-            // OPMVV vector-vector
-            inst.format = InstFormat::OPMVV;
-            inst.payload = OPMVVTypeFields(upper, middle, lower);
-            break;
-        case 0x3:
-            // OPIVI vector-immediate
-            inst.format = InstFormat::OPIVI;
-            inst.payload = OPIVITypeFields(upper, middle, lower);
-            break;
-        case 0x4:
-            // OPIVX vector-scalar
-            inst.format = InstFormat::OPIVX;
-            inst.payload = OPIVXTypeFields(upper, middle, lower);
-            break;
-        case 0x5:
-            // OPFVF vector-scalar
-            inst.format = InstFormat::OPFVF;
-            inst.payload = OPFVFTypeFields(upper, middle, lower);
-            break;
-        case 0x6:
-            // OPMVX vector-scalar
-            inst.format = InstFormat::OPMVX;
-            inst.payload = OPMVXTypeFields(upper, middle, lower);
-            break;
-        default:
-            throw std::runtime_error("Encountered undefined switch case (3)");
-            break;
-        }
+        decode_common_instruction_operands(code, inst);
+        if constexpr ((Isa & ISA_V) != 0)
+            decode_vector_operands(code, inst);
+    }
+    return pattern->name != UNKNOWN;
+}
+
+struct CompressedTableEntry
+{
+    DecodedInstruction inst;
+    bool valid;
+};
+
+using compressed_table_t = std::array<CompressedTableEntry, 1 << 16>;
 
-        switch (inst.format)
+// Every 16-bit encoding decoded once through the pattern table. Encodings
+// it rejects stay invalid and are sent through decode_pattern again on use.
+template <uint32_t Isa>
+static const compressed_table_t &get_compressed_table()
+{
+    static const std::unique_ptr<compressed_table_t> table = []
+    {
+        auto table = std::make_unique<compressed_table_t>();
+        for (uint32_t code = 0; code < table->size(); code++)
         {
-        case InstFormat::OPIVV:
-        case InstFormat::OPIVX:
-        case InstFormat::OPIVI:
-            switch (MASK(code, bitmask_31_26))
-            {
-            case 0x0:
-                inst.name = V_ADD;
-                inst.mnemonic = insts_mnem_map[V_ADD];
-                break;
-            case 0x2:
-                inst.name = V_SUB;
-                inst.mnemonic = insts_mnem_map[V_SUB];
-                break;
-            case 0x3:
-                inst.name = V_RSUB;
-                inst.mnemonic = insts_mnem_map[V_RSUB];
-                break;
-            case 0xC:
-                inst.name = V_SLIDEDOWN;
-                inst.mnemonic = insts_mnem_map[V_SLIDEDOWN];
-                break;
-            case 0xf:
-                inst.name = V_RGATHER;
-                inst.mnemonic = insts_mnem_map[V_RGATHER];
-                break;
+            CompressedTableEntry &entry = (*table)[code];
+            entry.valid = false;
+            if (!is_instruction_compressed(code))
+                continue;
+            entry.inst = DecodedInstruction{};
+            entry.inst.code = code;
+            entry.inst.compressed = true;
+            entry.valid = decode_pattern<Isa>(code, entry.inst);
+        }
+        return table;
+    }();
+    return *table;
+}
 
-            case 0x17:
-                inst.name = V_MERGE;
-                inst.mnemonic = insts_mnem_map[V_MERGE];
-                break;
-            case 0x25:
-                inst.name = V_SLL;
-                inst.mnemonic = insts_mnem_map[V_SLL];
-                break;
-            case 0x27:
-                inst.name = V_SMUL;
-                inst.mnemonic = insts_mnem_map[V_SMUL];
-                break;
+template <uint32_t Isa>
+DecodeStatus Decoder<Isa>::try_decode(uint32_t code, DecodedInstruction &inst)
+{
+    inst.code = code;
+    inst.compressed = is_instruction_compressed(code);
 
-            default:
-                inst.print();
-                std::cout << "undefined switch case, mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                // throw std::runtime_error("Encountered undefined switch case (4)");
-                break;
-            }
-            break;
-        case InstFormat::OPMVV:
-        case InstFormat::OPMVX:
-            switch (MASK(code, bitmask_31_26))
-            {
-            case 0x0:
-                inst.name = V_REDSUM;
-                inst.mnemonic = insts_mnem_map[V_REDSUM];
-                break;
-            case 0x2d:
-                inst.name = V_MACC;
-                inst.mnemonic = insts_mnem_map[V_MACC];
-                break;
-            case 0x10:
-                if (auto ptr = std::get_if<OPMVXTypeFields>(&inst.payload))
-                {
-                    switch (ptr->vs2)
-                    {
-                    case 0x0:
-                        inst.name = V_MV_S_X;
-                        inst.mnemonic = insts_mnem_map[V_MV_S_X];
-                        break;
-                    default:
-                        inst.print();
-                        std::cout << "mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                        std::cout << "rs1: " << uint32_t_to_dec_hex_bin(ptr->rs1) << " vs2: " << uint32_t_to_dec_hex_bin(ptr->vs2) << std::endl;
-                        throw std::runtime_error("Encountered undefined if branch (1)");
-                        break;
-                    }
-                }
-                else if (auto ptr = std::get_if<OPMVVTypeFields>(&inst.payload))
-                {
-                    switch (ptr->vs1)
-                    {
-                    case 0x0:
-                        inst.name = V_MV_X_S;
-                        inst.mnemonic = insts_mnem_map[V_MV_X_S];
-                        break;
-                    case 0x10:
-                        inst.name = V_POPC;
-                        inst.mnemonic = insts_mnem_map[V_POPC];
-                        break;
-                    case 0x11:
-                        inst.name = V_FIRST;
-                        inst.mnemonic = insts_mnem_map[V_FIRST];
-                        break;
-                    default:
-                        std::cout << "mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                        std::cout << "vs1: " << uint32_t_to_dec_hex_bin(ptr->vs1) << " vs2: " << uint32_t_to_dec_hex_bin(ptr->vs2) << std::endl;
-                        throw std::runtime_error("Encountered undefined if branch (8)");
-                        break;
-                    }
-                }
-                else
-                {
-                    inst.print();
-                    std::cout << "mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                    throw std::runtime_error("Encountered undefined if branch (3)");
-                }
-                break;
-            case 0x14:
-                if (auto ptr = std::get_if<OPMVVTypeFields>(&inst.payload))
-                {
-                    switch (ptr->vs1)
-                    {
-                    case 0x1:
-                        inst.name = V_MSBF;
-                        inst.mnemonic = insts_mnem_map[V_MSBF];
-                        break;
-                    case 0x2:
-                        inst.name = V_MSOF;
-                        inst.mnemonic = insts_mnem_map[V_MSOF];
-                        break;
-                    case 0x3:
-                        inst.name = V_MSIF;
-                        inst.mnemonic = insts_mnem_map[V_MSIF];
-                        break;
-                    case 0x10:
-                        inst.name = V_IOTA;
-                        inst.mnemonic = insts_mnem_map[V_IOTA];
-                        break;
-                    case 0x11:
-                        inst.name = V_ID_V;
-                        inst.mnemonic = insts_mnem_map[V_ID_V];
-                        break;
-                    }
-                }
-                break;
-            default:
-                inst.print();
-                std::cout << "undefined switch case (6), mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                // throw std::runtime_error("Encountered undefined switch case (6)");
-                break;
-            }
-            break;
-        case InstFormat::OPFVV:
-        case InstFormat::OPFVF:
-            switch (MASK(code, bitmask_31_26))
+    if constexpr ((Isa & ISA_C) != 0)
+    {
+        if (inst.compressed && code < (1 << 16))
+        {
+            const CompressedTableEntry &entry = get_compressed_table<Isa>()[code];
+            if (entry.valid)
             {
-            case 0x0:
-                inst.name = V_FADD;
-                inst.mnemonic = insts_mnem_map[V_FADD];
-                break;
-            case 0x1:
-                inst.name = V_FREDUSUM;
-                inst.mnemonic = insts_mnem_map[V_FREDUSUM];
-                break;
-            case 0x3:
-                inst.name = V_FREDOSUM;
-                inst.mnemonic = insts_mnem_map[V_FREDOSUM];
-                break;
-            case 0x10:
-                if (auto ptr = std::get_if<OPFVVTypeFields>(&inst.payload))
-                {
-                    if (ptr->vs2 == 0x0)
-                    {
-                        inst.name = V_FMV_S_F;
-                        inst.mnemonic = insts_mnem_map[V_FMV_S_F];
-                    }
-                    else if (ptr->vs1 == 0x0)
-                    {
-                        inst.name = V_FMV_F_S;
-                        inst.mnemonic = insts_mnem_map[V_FMV_F_S];
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Encountered undefined instruction arg value (1)");
-                    }
-                }
-                // TODO: this if is wrong. I do not understand how this is shared
-                else if (auto ptr = std::get_if<OPFVFTypeFields>(&inst.payload))
-                {
-                    if (ptr->vs2 == 0x0)
-                    {
-                        inst.name = V_FMV_S_F;
-                        inst.mnemonic = insts_mnem_map[V_FMV_S_F];
-                    }
-                    else if (ptr->rs1 == 0x0)
-                    {
-                        inst.name = V_FMV_F_S;
-                        inst.mnemonic = insts_mnem_map[V_FMV_F_S];
-                    }
-                    else
-                    {
-                        throw std::runtime_error("Encountered undefined instruction arg value (1)");
-                    }
-                }
-                else
-                {
-                    throw std::runtime_error("Encountered undefined instruction arg value (2)");
-                }
-                break;
-            case 0x17:
-                // TODO: shared space with vfmerge.vfm
-                inst.name = V_FMV;
-                inst.mnemonic = insts_mnem_map[V_FMV];
-                break;
-            case 0x1c:
-                inst.name = V_MFNE;
-                inst.mnemonic = insts_mnem_map[V_MFNE];
-                break;
-            case 0x24:
-                inst.name = V_FMUL;
-                inst.mnemonic = insts_mnem_map[V_FMUL];
-                break;
-            case 0x2b:
-                inst.name = V_FNMSUB;
-                inst.mnemonic = insts_mnem_map[V_FNMSUB];
-                break;
-            case 0x2c:
-                inst.name = V_FMACC;
-                inst.mnemonic = insts_mnem_map[V_FMACC];
-                break;
-            case 0x2f:
-                inst.name = V_FNMSAC;
-                inst.mnemonic = insts_mnem_map[V_FNMSAC];
-                break;
-
-            default:
-                inst.print();
-                std::cout << "mask: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_31_26)) << std::endl;
-                throw std::runtime_error("Encountered undefined switch case (5)");
-                break;
+                inst = entry.inst;
+                return DecodeStatus::OK;
             }
-            break;
-        default:
-            throw std::runtime_error("Encountered undefined switch case (7)");
-            break;
         }
     }
+    return decode_pattern<Isa>(code, inst) ? DecodeStatus::OK : DecodeStatus::UNKNOWN_ENCODING;
 }
 
-void decode_load_fp_instruction(uint32_t code, DecodedInstruction &inst)
+template <uint32_t Isa>
+void Decoder<Isa>::decode(uint32_t code, DecodedInstruction &inst)
 {
-    inst.name = LOAD_PLACEHOLDER;
-    inst.mnemonic = insts_mnem_map[LOAD_PLACEHOLDER];
-    // TODO: implement this
-    // inst.print();
-    // throw std::runtime_error("Unknown load fp instruction");
+    DecodeStatus status = try_decode(code, inst);
+    if (status != DecodeStatus::OK)
+        throw std::runtime_error(decode_status_message(status, code));
 }
 
-void decode_store_fp_instruction(uint32_t code, DecodedInstruction &inst)
+template <uint32_t Isa>
+void Decoder<Isa>::identify(uint32_t code, InstIdentity &identity)
 {
-    inst.name = STORE_PLACEHOLDER;
-    inst.mnemonic = insts_mnem_map[STORE_PLACEHOLDER];
-    // TODO: implement
-    // inst.print();
-    // throw std::runtime_error("Unknown store fp instruction");
+    const InstPattern *pattern = PatternDecoder<isa_patterns<Isa>>::match(code);
+    if (pattern == nullptr || pattern->is_reject())
+    {
+        identity = InstIdentity{UNKNOWN, InstFormat::UNKNOWN, 0};
+        return;
+    }
+    identity = InstIdentity{pattern->name, pattern->format, pattern->ext};
 }
 
-void decode_system_instruction(uint32_t code, DecodedInstruction &inst)
+// Batch classification key: 0 for compressed words, 1 + opcode[6:2] for
+// uncompressed ones.
+static constexpr std::size_t batch_bucket_count = 33;
+
+static void classify_batch_scalar(const uint32_t *codes, uint8_t *keys, std::size_t count)
 {
-    switch (MASK(code, bitmask_6_0))
+    for (std::size_t i = 0; i < count; i++)
     {
-    case 0x73:
-        inst.name = CSRRS;
-        inst.mnemonic = insts_mnem_map[CSRRS];
-        break;
-    default:
-        inst.print();
-        std::cout << "Low 6 bits: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_6_0)) << std::endl;
-        throw std::runtime_error("Unknown system instruction");
+        uint32_t code = codes[i];
+        keys[i] = is_instruction_compressed(code) ? 0 : 1 + ((code >> 2) & 0x1f);
     }
 }
 
-void decode_common_instruction_operands(uint32_t code, DecodedInstruction &inst)
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2"))) static void classify_batch_sse2(const uint32_t *codes, uint8_t *keys, std::size_t count)
 {
-    const uint8_t bits_31_27 = MASK(code, bitmask_31_27);
-    const uint8_t bits_31_25 = MASK(code, bitmask_31_25);
-    const uint8_t bits_30_25 = MASK(code, bitmask_30_25);
-    const uint8_t bits_24_20 = MASK(code, bitmask_24_20);
-    const uint8_t bits_19_15 = MASK(code, bitmask_19_15);
-    const uint8_t bits_11_7 = MASK(code, bitmask_11_7);
-    const uint16_t bits_31_20 = MASK(code, bitmask_31_20);
-    const uint8_t bits_11_8 = MASK(code, bitmask_11_8);
-    const uint8_t bits_7 = MASK(code, bitmask_7);
-    const uint32_t bits_31_12 = MASK(code, bitmask_31_12);
-    const uint16_t bits_30_21 = MASK(code, bitmask_30_21);
-    const uint8_t bits_20 = MASK(code, bitmask_20);
-    const uint8_t bits_19_12 = MASK(code, bitmask_19_12);
-
-    switch (inst.format)
-    {
-    case InstFormat::R:
-        inst.payload = RTypeFields(
-            (uint8_t)bits_31_25,
-            (uint8_t)bits_24_20,
-            (uint8_t)bits_19_15,
-            (uint8_t)bits_11_7);
-
-        break;
-    case InstFormat::R_4:
-        inst.payload = R_4TypeFields(
-            (uint8_t)bits_31_27,
-            (uint8_t)bits_24_20,
-            (uint8_t)bits_19_15,
-            (uint8_t)bits_11_7);
-
-        break;
-    case InstFormat::I:
-        inst.payload = ITypeFields(
-            (uint16_t)bits_31_20,
-            (uint8_t)bits_19_15,
-            (uint8_t)bits_11_7);
+    const __m128i low_mask = _mm_set1_epi32(0x3);
+    const __m128i opcode_mask = _mm_set1_epi32(0x1f);
+    const __m128i one = _mm_set1_epi32(1);
 
-        break;
-    case InstFormat::S:
-        inst.payload = STypeFields(
-            (uint8_t)bits_31_25,
-            (uint8_t)bits_24_20,
-            (uint8_t)bits_19_15,
-            (uint8_t)bits_11_7);
-
-        break;
-    case InstFormat::B:
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4)
     {
-        uint16_t immediate = (((bits_30_25 << 4) | bits_11_8) << 1) | bits_7;
-        inst.payload = BTypeFields(
-            (uint8_t)bits_30_25,
-            (uint8_t)bits_24_20,
-            (uint8_t)bits_19_15,
-            (uint8_t)bits_11_8,
-            (uint8_t)bits_7,
-            sign_extend(extract_offset<decltype(b_offset_bit_map)>(immediate, b_offset_bit_map), 12));
+        __m128i code = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i));
+        __m128i uncompressed = _mm_cmpeq_epi32(_mm_and_si128(code, low_mask), low_mask);
+        __m128i key = _mm_add_epi32(_mm_and_si128(_mm_srli_epi32(code, 2), opcode_mask), one);
+        key = _mm_and_si128(key, uncompressed);
+        // keys are below 64, so saturating packs keep them intact
+        key = _mm_packus_epi16(_mm_packs_epi32(key, key), key);
+        int packed = _mm_cvtsi128_si32(key);
+        memcpy(keys + i, &packed, 4);
     }
+    classify_batch_scalar(codes + i, keys + i, count - i);
+}
 
-    break;
-    case InstFormat::U:
-        inst.payload = UTypeFields(
-            (uint32_t)bits_31_12,
-            (uint8_t)bits_11_7);
-
-        break;
-    case InstFormat::J:
+__attribute__((target("avx2"))) static void classify_batch_avx2(const uint32_t *codes, uint8_t *keys, std::size_t count)
+{
+    const __m256i low_mask = _mm256_set1_epi32(0x3);
+    const __m256i opcode_mask = _mm256_set1_epi32(0x1f);
+    const __m256i one = _mm256_set1_epi32(1);
+    // low byte of every dword to the bottom of each lane, then both lanes together
+    const __m256i gather_bytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i gather_lanes = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8)
     {
-        uint32_t immediate = MASK(code, bitmask_31_12);
-
-        inst.payload = JTypeFields(
-            (uint16_t)bits_30_21,
-            (uint8_t)bits_20,
-            (uint8_t)bits_19_12,
-            (uint8_t)bits_11_7,
-            sign_extend(extract_offset<decltype(j_imm_bit_map)>(immediate, j_imm_bit_map), 20));
+        __m256i code = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(codes + i));
+        __m256i uncompressed = _mm256_cmpeq_epi32(_mm256_and_si256(code, low_mask), low_mask);
+        __m256i key = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(code, 2), opcode_mask), one);
+        key = _mm256_and_si256(key, uncompressed);
+        key = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(key, gather_bytes), gather_lanes);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(keys + i), _mm256_castsi256_si128(key));
     }
+    classify_batch_sse2(codes + i, keys + i, count - i);
+}
+#endif
 
-    break;
-    default:
-        throw std::runtime_error("Unknown instruction format to decode operands");
-    }
+using classify_batch_t = void (*)(const uint32_t *, uint8_t *, std::size_t);
+
+static classify_batch_t select_classify_batch()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2"))
+        return classify_batch_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return classify_batch_sse2;
+#endif
+    return classify_batch_scalar;
 }
 
-void decode_common_instruction(uint32_t code, DecodedInstruction &inst)
+template <uint32_t Isa>
+std::size_t Decoder<Isa>::decode_batch(std::span<const uint32_t> codes, std::span<DecodedInstruction> insts)
 {
-    switch (MASK(code, bitmask_6_0))
+    static const classify_batch_t classify_batch = select_classify_batch();
+
+    if (insts.size() < codes.size())
+        throw std::invalid_argument("decode_batch: output span is smaller than the input");
+
+    const std::size_t count = codes.size();
+    std::vector<uint8_t> keys(count);
+    classify_batch(codes.data(), keys.data(), count);
+
+    // counting sort of the positions by bucket
+    std::array<uint32_t, batch_bucket_count + 1> offsets{};
+    for (uint8_t key : keys)
+        offsets[key + 1]++;
+    for (std::size_t b = 1; b < offsets.size(); b++)
+        offsets[b] += offsets[b - 1];
+    std::vector<uint32_t> order(count);
+    std::array<uint32_t, batch_bucket_count> fill;
+    std::copy(offsets.begin(), offsets.end() - 1, fill.begin());
+    for (std::size_t i = 0; i < count; i++)
+        order[fill[keys[i]]++] = i;
+
+    std::size_t unknown = 0;
+    for (uint32_t pos = offsets[0]; pos < offsets[1]; pos++)
     {
-    case 0x3:
-        switch (MASK(code, bitmask_14_12))
-        {
-        case 0x0:
-            inst.name = LB;
-            inst.mnemonic = insts_mnem_map[LB];
-            inst.format = InstFormat::I;
-            break;
-        case 0x1:
-            inst.name = LH;
-            inst.mnemonic = insts_mnem_map[LH];
-            inst.format = InstFormat::I;
-            break;
-        case 0x2:
-            inst.name = LW;
-            inst.mnemonic = insts_mnem_map[LW];
-            inst.format = InstFormat::I;
-            break;
-        case 0x4:
-            inst.name = LBU;
-            inst.mnemonic = insts_mnem_map[LBU];
-            inst.format = InstFormat::I;
-            break;
-        case 0x5:
-            inst.name = LHU;
-            inst.mnemonic = insts_mnem_map[LHU];
-            inst.format = InstFormat::I;
-            break;
-        case 0x6:
-            inst.name = LWU;
-            inst.mnemonic = insts_mnem_map[LWU];
-            inst.format = InstFormat::I;
-            break;
-        case 0x3:
-            inst.name = LD;
-            inst.mnemonic = insts_mnem_map[LD];
-            inst.format = InstFormat::I;
-            break;
-        default:
-            inst.print();
-            throw std::runtime_error("Unknown common instruction (10)");
-            break;
-        }
-        break;
-    case 0x13:
-        inst.format = InstFormat::I;
-        if (MASK(code, bitmask_31_20) == 0x0 && MASK(code, bitmask_19_15) == 0x0 && MASK(code, bitmask_11_7) == 0x0)
-        {
-            inst.name = NOP;
-            inst.mnemonic = insts_mnem_map[NOP];
-        }
-        inst.name = ADDI;
-        inst.mnemonic = insts_mnem_map[ADDI];
-        break;
-    case 0x17:
-        inst.name = AUIPC;
-        inst.mnemonic = insts_mnem_map[AUIPC];
-        inst.format = InstFormat::U;
-        break;
-    case 0x1b:
-        inst.format = InstFormat::I;
-        switch (MASK(code, bitmask_14_12))
+        uint32_t i = order[pos];
+        uint32_t code = codes[i];
+        if constexpr ((Isa & ISA_C) != 0)
         {
-        case 0x0:
-            inst.name = ADDIW;
-            inst.mnemonic = insts_mnem_map[ADDIW];
-            break;
-
-        case 0x1:
-            inst.name = SLLIW;
-            inst.mnemonic = insts_mnem_map[SLLIW];
-            break;
-
-        case 0x5:
-
-            inst.name = SLRIW_SAIW;
-            inst.mnemonic = insts_mnem_map[SLRIW_SAIW];
-            break;
-
-        default:
-            throw std::runtime_error("Unknown common instruction 11");
-            break;
+            const compressed_table_t &table = get_compressed_table<Isa>();
+            if (code < (1 << 16) && table[code].valid)
+            {
+                insts[i] = table[code].inst;
+                continue;
+            }
         }
+        insts[i] = DecodedInstruction{};
+        insts[i].code = code;
+        insts[i].compressed = true;
+        unknown += !decode_pattern<Isa>(code, insts[i]);
+    }
 
-        break;
-    case 0xf:
-        inst.name = FENCE;
-        inst.mnemonic = insts_mnem_map[FENCE];
-        inst.format = InstFormat::I;
-        break;
-    case 0x23:
-        inst.name = SD;
-        inst.mnemonic = insts_mnem_map[SD];
-        inst.format = InstFormat::S;
-        break;
-    case 0x2f:
-        inst.name = LR;
-        inst.mnemonic = insts_mnem_map[LR];
-        inst.format = InstFormat::R;
-        break;
-    case 0x33:
-        inst.name = ADD;
-        inst.mnemonic = insts_mnem_map[ADD];
-        inst.format = InstFormat::R;
-        break;
-    case 0x37:
-        inst.name = LUI;
-        inst.mnemonic = insts_mnem_map[LUI];
-        inst.format = InstFormat::U;
-        break;
-    case 0x3b:
-        inst.name = SUBW;
-        inst.mnemonic = insts_mnem_map[SUBW];
-        inst.format = InstFormat::R;
-        break;
-    case 0x43:
-        inst.name = FMADD;
-        inst.mnemonic = insts_mnem_map[FMADD];
-        inst.format = InstFormat::R_4;
-        break;
-    case 0x4b:
-        inst.name = FNMSUB;
-        inst.mnemonic = insts_mnem_map[FNMSUB];
-        inst.format = InstFormat::R_4;
-        break;
-    case 0x53:
-        inst.name = FMV;
-        inst.mnemonic = insts_mnem_map[FMV];
-        inst.format = InstFormat::R;
-        break;
-    case 0x63:
-        inst.format = InstFormat::B;
-        switch (MASK(code, bitmask_14_12))
+    for (std::size_t bucket = 1; bucket < batch_bucket_count; bucket++)
+    {
+        for (uint32_t pos = offsets[bucket]; pos < offsets[bucket + 1]; pos++)
         {
-        case 0x0:
-            inst.name = BEQ;
-            inst.mnemonic = insts_mnem_map[BEQ];
-            break;
-        case 0x1:
-            inst.name = BNE;
-            inst.mnemonic = insts_mnem_map[BNE];
-            break;
-        case 0x4:
-            inst.name = BLT;
-            inst.mnemonic = insts_mnem_map[BLT];
-            break;
-        case 0x5:
-            inst.name = BGE;
-            inst.mnemonic = insts_mnem_map[BGE];
-            break;
-        case 0x6:
-            inst.name = BLTU;
-            inst.mnemonic = insts_mnem_map[BLTU];
-            break;
-        case 0x7:
-            inst.name = BGEU;
-            inst.mnemonic = insts_mnem_map[BGEU];
-            break;
-        default:
-            break;
+            uint32_t i = order[pos];
+            DecodedInstruction &inst = insts[i];
+            inst = DecodedInstruction{};
+            inst.code = codes[i];
+            unknown += !decode_pattern<Isa>(codes[i], inst);
         }
-
-        break;
-    case 0x67:
-        inst.name = JALR;
-        inst.mnemonic = insts_mnem_map[JALR];
-        inst.format = InstFormat::I;
-        break;
-    case 0x6f:
-        inst.name = JAL;
-        inst.mnemonic = insts_mnem_map[JAL];
-        inst.format = InstFormat::J;
-        break;
-    default:
-        inst.print();
-        std::cout << "Low 6 bits: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_6_0)) << std::endl;
-        throw std::runtime_error("Unknown common instruction");
-    }
-    if (inst.format == InstFormat::UNKNOWN)
-    {
-        inst.print();
-        throw std::runtime_error("Unknown format");
     }
-
-    decode_common_instruction_operands(code, inst);
+    return unknown;
 }
 
-void decode_uncompressed(uint32_t code, DecodedInstruction &inst)
+template struct Decoder<ISA_I>;
+template struct Decoder<ISA_I | ISA_M | ISA_A | ISA_C>;
+template struct Decoder<ISA_G | ISA_C | ISA_ZICNTR>;
+template struct Decoder<ISA_ALL>;
+
+// smallest first, so select_decoder picks the tightest fit
+static constexpr IsaDecoder isa_decoders[] = {
+    {ISA_I, Decoder<ISA_I>::try_decode, Decoder<ISA_I>::decode_batch, Decoder<ISA_I>::identify},
+    {ISA_I | ISA_M | ISA_A | ISA_C, Decoder<ISA_I | ISA_M | ISA_A | ISA_C>::try_decode,
+     Decoder<ISA_I | ISA_M | ISA_A | ISA_C>::decode_batch, Decoder<ISA_I | ISA_M | ISA_A | ISA_C>::identify},
+    {ISA_G | ISA_C | ISA_ZICNTR, Decoder<ISA_G | ISA_C | ISA_ZICNTR>::try_decode,
+     Decoder<ISA_G | ISA_C | ISA_ZICNTR>::decode_batch, Decoder<ISA_G | ISA_C | ISA_ZICNTR>::identify},
+    {ISA_ALL, Decoder<ISA_ALL>::try_decode, Decoder<ISA_ALL>::decode_batch, Decoder<ISA_ALL>::identify},
+};
+
+const IsaDecoder &select_decoder(uint32_t isa)
 {
-    switch (MASK(code, bitmask_6_0))
+    for (const IsaDecoder &decoder : isa_decoders)
     {
-    // load store opcodes are overloaded for RVV and F/D
-    case 0x7:
-        decode_load_fp_instruction(code, inst);
-        break;
-    case 0x27:
-        decode_store_fp_instruction(code, inst);
-        break;
-    // RVV
-    case 0x57:
-        decode_vector_op_v_instruction(code, inst);
-        break;
-    // system
-    case 0x73:
-        decode_system_instruction(code, inst);
-        break;
-    default:
-        decode_common_instruction(code, inst);
-        break;
+        if ((decoder.isa & isa) == isa)
+            return decoder;
     }
+    throw std::runtime_error("No decoder covers ISA " + isa_to_string(isa));
 }
 
 void decode_instruction(uint32_t code, DecodedInstruction &inst)
 {
-    inst.compressed = is_instruction_compressed(code);
+    Decoder<ISA_ALL>::decode(code, inst);
+}
 
-    if (inst.compressed)
-    {
-        decode_compressed(code, inst);
-    }
-    else
-    {
-        decode_uncompressed(code, inst);
-    }
-}
\ No newline at end of file
+std::size_t decode_batch(std::span<const uint32_t> codes, std::span<DecodedInstruction> insts)
+{
+    return Decoder<ISA_ALL>::decode_batch(codes, insts);
+}
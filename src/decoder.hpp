@@ -2,8 +2,11 @@
 #define DECODER_HPP
 
 #include <cstdint>
+#include <span>
 
 #include "instructions.hpp"
+#include "isa.hpp"
+#include "decode_status.hpp"
 
 #define bitmask_12 0x1000
 #define bitmask_12_shift 12
@@ -124,6 +127,62 @@
 
 #define MASK(c, m) ((c & m) >> m##_shift)
 
+// Fills the operands of a compressed word whose name and format are set;
+// shared by the 64K compressed table and the pattern decoder.
+void decode_compressed_operands(uint32_t code, DecodedInstruction &inst);
+
+// Decodes with every extension enabled (ISA_ALL).
 void decode_instruction(uint32_t code, DecodedInstruction &inst);
 
+// Decodes insts[i] from codes[i] for a whole batch. The words are first
+// classified (with SSE2/AVX2 where available) and grouped by major opcode,
+// then every group is matched against the pattern table in one loop, so
+// each bucket of the pattern dispatch stays hot. Unknown encodings do not
+// throw: they are left with !is_known() and counted in the return value.
+std::size_t decode_batch(std::span<const uint32_t> codes, std::span<DecodedInstruction> insts);
+
+// What a word encodes, without its operands: the pattern match alone,
+// which is all a filter needs to reject it.
+struct InstIdentity
+{
+    InstEnum name;
+    InstFormat format;
+    // IsaExtension bits the encoding needs, 0 for unknown words
+    uint32_t ext;
+};
+
+// Decoder specialised for the extensions in Isa: patterns of other
+// extensions are compiled out of the dispatch, so their encodings are
+// reported as unknown. Instantiated in decoder.cpp for the ISAs listed
+// there; use select_decoder to get one at runtime.
+template <uint32_t Isa>
+struct Decoder
+{
+    // exception-free; on UNKNOWN_ENCODING inst is left with !is_known()
+    static DecodeStatus try_decode(uint32_t code, DecodedInstruction &inst);
+
+    // throws std::runtime_error on unknown encodings
+    static void decode(uint32_t code, DecodedInstruction &inst);
+
+    static std::size_t decode_batch(std::span<const uint32_t> codes, std::span<DecodedInstruction> insts);
+
+    // unknown encodings are UNKNOWN/InstFormat::UNKNOWN with ext 0
+    static void identify(uint32_t code, InstIdentity &identity);
+};
+
+using try_decode_fn_t = DecodeStatus (*)(uint32_t, DecodedInstruction &);
+using decode_batch_fn_t = std::size_t (*)(std::span<const uint32_t>, std::span<DecodedInstruction>);
+using identify_fn_t = void (*)(uint32_t, InstIdentity &);
+
+struct IsaDecoder
+{
+    uint32_t isa;
+    try_decode_fn_t try_decode;
+    decode_batch_fn_t decode_batch;
+    identify_fn_t identify;
+};
+
+// The smallest built-in decoder covering every extension in isa.
+const IsaDecoder &select_decoder(uint32_t isa);
+
 #endif
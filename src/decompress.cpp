@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "decompress.hpp"
+
+// compressed bytes read from the file per refill
+static constexpr std::size_t input_buffer_size = 1 << 17;
+
+// magic number 0x184D2A50-0x184D2A5F, little endian
+static bool is_zstd_skippable_frame(std::string_view data)
+{
+    return data.size() >= 4 && (static_cast<unsigned char>(data[0]) & 0xf0) == 0x50 &&
+           static_cast<unsigned char>(data[1]) == 0x2a && static_cast<unsigned char>(data[2]) == 0x4d &&
+           static_cast<unsigned char>(data[3]) == 0x18;
+}
+
+Compression detect_compression(std::string_view prefix)
+{
+    auto starts_with = [&](std::initializer_list<unsigned char> magic)
+    {
+        // prefix may be shorter than the longest magic number
+        if (prefix.size() < magic.size())
+            return false;
+        std::size_t i = 0;
+        for (unsigned char byte : magic)
+        {
+            if (static_cast<unsigned char>(prefix[i++]) != byte)
+                return false;
+        }
+        return true;
+    };
+
+    if (starts_with({0x1f, 0x8b}))
+        return Compression::GZIP;
+    if (starts_with({0xfd, '7', 'z', 'X', 'Z', 0x00}))
+        return Compression::XZ;
+    if (starts_with({0x28, 0xb5, 0x2f, 0xfd}))
+        return Compression::ZSTD;
+    // skippable frame 0x184D2A50-0x184D2A5F, e.g. a seekable zstd file
+    // whose seek table comes first
+    if (is_zstd_skippable_frame(prefix))
+        return Compression::ZSTD;
+    return Compression::NONE;
+}
+
+const char *compression_name(Compression compression)
+{
+    switch (compression)
+    {
+    case Compression::GZIP:
+        return "gzip";
+    case Compression::XZ:
+        return "xz";
+    case Compression::ZSTD:
+        return "zstd";
+    default:
+        return "none";
+    }
+}
+
+// Plain reads; the bytes consumed by detection are served first.
+class FdSource : public ByteSource
+{
+private:
+    int m_fd;
+    std::string m_prefix;
+    std::size_t m_prefix_pos = 0;
+
+public:
+    FdSource(int fd, std::string prefix) : m_fd(fd), m_prefix(std::move(prefix)) {}
+
+    std::size_t read(char *data, std::size_t size) override
+    {
+        if (m_prefix_pos < m_prefix.size())
+        {
+            std::size_t count = std::min(size, m_prefix.size() - m_prefix_pos);
+            memcpy(data, m_prefix.data() + m_prefix_pos, count);
+            m_prefix_pos += count;
+            return count;
+        }
+
+        ssize_t count;
+        do
+        {
+            count = ::read(m_fd, data, size);
+        } while (count < 0 && errno == EINTR);
+        if (count < 0)
+        {
+            throw std::runtime_error(std::string("Could not read input: ") + strerror(errno));
+        }
+        return static_cast<std::size_t>(count);
+    }
+};
+
+// Base of the decompressing sources: owns the compressed input buffer.
+class CompressedSource : public ByteSource
+{
+protected:
+    std::unique_ptr<ByteSource> m_input;
+    std::unique_ptr<char[]> m_buffer = std::make_unique<char[]>(input_buffer_size);
+    bool m_input_eof = false;
+
+    // refills the input buffer, returns the number of bytes now in it
+    std::size_t refill()
+    {
+        std::size_t count = m_input->read(m_buffer.get(), input_buffer_size);
+        m_input_eof = count == 0;
+        return count;
+    }
+
+public:
+    explicit CompressedSource(std::unique_ptr<ByteSource> input) : m_input(std::move(input)) {}
+};
+
+#ifdef HAVE_ZLIB
+class GzipSource : public CompressedSource
+{
+private:
+    z_stream m_stream{};
+    bool m_member_done = false;
+
+public:
+    explicit GzipSource(std::unique_ptr<ByteSource> input) : CompressedSource(std::move(input))
+    {
+        // 32: detect the gzip or zlib header
+        if (inflateInit2(&m_stream, 15 + 32) != Z_OK)
+        {
+            throw std::runtime_error("Could not initialise zlib");
+        }
+    }
+
+    ~GzipSource() override
+    {
+        inflateEnd(&m_stream);
+    }
+
+    std::size_t read(char *data, std::size_t size) override
+    {
+        m_stream.next_out = reinterpret_cast<Bytef *>(data);
+        m_stream.avail_out = static_cast<uInt>(size);
+
+        while (m_stream.avail_out == size)
+        {
+            if (m_stream.avail_in == 0)
+            {
+                m_stream.next_in = reinterpret_cast<Bytef *>(m_buffer.get());
+                m_stream.avail_in = m_input_eof ? 0 : static_cast<uInt>(refill());
+                if (m_stream.avail_in == 0)
+                {
+                    if (!m_member_done)
+                        throw std::runtime_error("Truncated gzip input");
+                    break;
+                }
+            }
+            // gzip allows several members back to back, as written by
+            // appending to a .gz file
+            if (m_member_done)
+            {
+                inflateReset(&m_stream);
+                m_member_done = false;
+            }
+
+            int result = inflate(&m_stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END)
+            {
+                m_member_done = true;
+            }
+            else if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                throw std::runtime_error(std::string("Corrupt gzip input: ") +
+                                         (m_stream.msg ? m_stream.msg : "inflate failed"));
+            }
+        }
+        return size - m_stream.avail_out;
+    }
+};
+#endif
+
+#ifdef HAVE_LZMA
+class XzSource : public CompressedSource
+{
+private:
+    lzma_stream m_stream = LZMA_STREAM_INIT;
+    bool m_done = false;
+
+public:
+    explicit XzSource(std::unique_ptr<ByteSource> input) : CompressedSource(std::move(input))
+    {
+        if (lzma_stream_decoder(&m_stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        {
+            throw std::runtime_error("Could not initialise liblzma");
+        }
+    }
+
+    ~XzSource() override
+    {
+        lzma_end(&m_stream);
+    }
+
+    std::size_t read(char *data, std::size_t size) override
+    {
+        m_stream.next_out = reinterpret_cast<uint8_t *>(data);
+        m_stream.avail_out = size;
+
+        while (!m_done && m_stream.avail_out == size)
+        {
+            if (m_stream.avail_in == 0 && !m_input_eof)
+            {
+                m_stream.next_in = reinterpret_cast<const uint8_t *>(m_buffer.get());
+                m_stream.avail_in = refill();
+            }
+
+            lzma_ret result = lzma_code(&m_stream, m_input_eof ? LZMA_FINISH : LZMA_RUN);
+            if (result == LZMA_STREAM_END)
+            {
+                m_done = true;
+            }
+            else if (result == LZMA_BUF_ERROR && m_input_eof)
+            {
+                throw std::runtime_error("Truncated xz input");
+            }
+            else if (result != LZMA_OK && result != LZMA_BUF_ERROR)
+            {
+                throw std::runtime_error("Corrupt xz input (liblzma error " + std::to_string(result) + ")");
+            }
+        }
+        return size - m_stream.avail_out;
+    }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdSource : public CompressedSource
+{
+private:
+    ZSTD_DStream *m_stream = ZSTD_createDStream();
+    ZSTD_inBuffer m_in{nullptr, 0, 0};
+    // 0 once the last frame is complete
+    std::size_t m_hint = 1;
+
+public:
+    explicit ZstdSource(std::unique_ptr<ByteSource> input) : CompressedSource(std::move(input))
+    {
+        if (!m_stream)
+        {
+            throw std::runtime_error("Could not initialise libzstd");
+        }
+    }
+
+    ~ZstdSource() override
+    {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    std::size_t read(char *data, std::size_t size) override
+    {
+        ZSTD_outBuffer out{data, size, 0};
+
+        while (out.pos == 0)
+        {
+            if (m_in.pos == m_in.size)
+            {
+                if (m_input_eof || (m_in.size = refill()) == 0)
+                {
+                    if (m_hint != 0)
+                        throw std::runtime_error("Truncated zstd input");
+                    break;
+                }
+                m_in.src = m_buffer.get();
+                m_in.pos = 0;
+            }
+
+            // a DStream moves on to the next frame by itself, and skips
+            // skippable ones
+            m_hint = ZSTD_decompressStream(m_stream, &out, &m_in);
+            if (ZSTD_isError(m_hint))
+            {
+                throw std::runtime_error(std::string("Corrupt zstd input: ") + ZSTD_getErrorName(m_hint));
+            }
+        }
+        return out.pos;
+    }
+};
+#endif
+
+std::unique_ptr<ByteSource> open_byte_source(int fd)
+{
+    // a pipe may deliver the magic number in pieces
+    std::string prefix(compression_magic_size, '\0');
+    std::size_t filled = 0;
+    FdSource raw(fd, "");
+    while (filled < prefix.size())
+    {
+        std::size_t count = raw.read(prefix.data() + filled, prefix.size() - filled);
+        if (count == 0)
+            break;
+        filled += count;
+    }
+    prefix.resize(filled);
+
+    const Compression compression = detect_compression(prefix);
+    auto input = std::make_unique<FdSource>(fd, std::move(prefix));
+    switch (compression)
+    {
+    case Compression::NONE:
+        return input;
+#ifdef HAVE_ZLIB
+    case Compression::GZIP:
+        return std::make_unique<GzipSource>(std::move(input));
+#endif
+#ifdef HAVE_LZMA
+    case Compression::XZ:
+        return std::make_unique<XzSource>(std::move(input));
+#endif
+#ifdef HAVE_ZSTD
+    case Compression::ZSTD:
+        return std::make_unique<ZstdSource>(std::move(input));
+#endif
+    default:
+        throw std::runtime_error(std::string("Input is ") + compression_name(compression) +
+                                 " compressed, but the parser was built without " + compression_name(compression) +
+                                 " support");
+    }
+}
+
+bool zstd_supported()
+{
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef HAVE_ZSTD
+std::vector<std::string_view> split_zstd_frames(std::string_view data)
+{
+    std::vector<std::string_view> frames;
+    while (!data.empty())
+    {
+        std::size_t size = ZSTD_findFrameCompressedSize(data.data(), data.size());
+        if (ZSTD_isError(size))
+        {
+            throw std::runtime_error(std::string("Corrupt zstd input: ") + ZSTD_getErrorName(size));
+        }
+        if (!is_zstd_skippable_frame(data))
+            frames.push_back(data.substr(0, size));
+        data.remove_prefix(size);
+    }
+    return frames;
+}
+
+void decompress_zstd_frame(std::string_view frame, std::string &out, std::size_t offset)
+{
+    // one context per decompression thread, reused across frames
+    thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+
+    const unsigned long long content_size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+    if (content_size == ZSTD_CONTENTSIZE_ERROR)
+    {
+        throw std::runtime_error("Corrupt zstd frame header");
+    }
+
+    if (content_size != ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        std::size_t result = 0;
+        out.resize_and_overwrite(offset + content_size, [&](char *data, std::size_t size)
+                                 {
+                                     result = ZSTD_decompressDCtx(context.get(), data + offset, size - offset,
+                                                                  frame.data(), frame.size());
+                                     return ZSTD_isError(result) ? offset : offset + result; });
+        if (ZSTD_isError(result))
+        {
+            throw std::runtime_error(std::string("Corrupt zstd input: ") + ZSTD_getErrorName(result));
+        }
+        return;
+    }
+
+    // streamed frames do not record their size, grow the output as needed
+    ZSTD_DCtx_reset(context.get(), ZSTD_reset_session_only);
+    ZSTD_inBuffer in{frame.data(), frame.size(), 0};
+    std::size_t end = offset;
+    std::size_t hint = 1;
+    while (hint != 0)
+    {
+        const std::size_t old_size = end;
+        const std::size_t want = std::max(ZSTD_DStreamOutSize(), 2 * (old_size - offset));
+        out.resize_and_overwrite(old_size + want, [&](char *data, std::size_t size)
+                                 {
+                                     ZSTD_outBuffer buffer{data + old_size, size - old_size, 0};
+                                     hint = ZSTD_decompressStream(context.get(), &buffer, &in);
+                                     end = old_size + (ZSTD_isError(hint) ? 0 : buffer.pos);
+                                     return end; });
+        if (ZSTD_isError(hint))
+        {
+            throw std::runtime_error(std::string("Corrupt zstd input: ") + ZSTD_getErrorName(hint));
+        }
+        if (hint != 0 && in.pos == in.size && end == old_size)
+        {
+            throw std::runtime_error("Truncated zstd input");
+        }
+    }
+}
+#else
+std::vector<std::string_view> split_zstd_frames(std::string_view)
+{
+    throw std::runtime_error("The parser was built without zstd support");
+}
+
+void decompress_zstd_frame(std::string_view, std::string &, std::size_t)
+{
+    throw std::runtime_error("The parser was built without zstd support");
+}
+#endif
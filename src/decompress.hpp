@@ -0,0 +1,54 @@
+#ifndef DECOMPRESS_HPP
+#define DECOMPRESS_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class Compression
+{
+    NONE,
+    GZIP,
+    XZ,
+    ZSTD,
+};
+
+// longest magic number detect_compression looks at
+inline constexpr std::size_t compression_magic_size = 6;
+
+// Identifies the container from the first bytes of the input.
+Compression detect_compression(std::string_view prefix);
+
+const char *compression_name(Compression compression);
+
+// Raw bytes of a trace, decompressed on the fly where needed.
+class ByteSource
+{
+public:
+    virtual ~ByteSource() = default;
+
+    // Fills up to size bytes and returns how many were written; 0 only at
+    // the end of the input. Throws std::runtime_error on read or format
+    // errors.
+    virtual std::size_t read(char *data, std::size_t size) = 0;
+};
+
+// Wraps fd, which stays owned by the caller. The first bytes are peeked to
+// pick plain reads or a gzip, xz or zstd decoder; a format the binary was
+// built without is reported when it is detected.
+std::unique_ptr<ByteSource> open_byte_source(int fd);
+
+// Compressed frames of a zstd file in order, skippable frames (such as the
+// seek table of the seekable format) left out. Every frame decompresses
+// independently, which is what makes parallel decompression possible.
+std::vector<std::string_view> split_zstd_frames(std::string_view data);
+
+// Decompresses one frame into out starting at offset; out is resized to
+// end with the frame's content.
+void decompress_zstd_frame(std::string_view frame, std::string &out, std::size_t offset);
+
+bool zstd_supported();
+
+#endif
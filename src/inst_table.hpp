@@ -0,0 +1,335 @@
+#ifndef INST_TABLE_HPP
+#define INST_TABLE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "instructions.hpp"
+#include "isa.hpp"
+
+// One encoding in the style of riscv-opcodes: a word decodes as name/format
+// when (code & mask) == match. Entries are tried in table order, so more
+// specific encodings come before the catch-all entries that follow them.
+// ext lists the extensions that must all be enabled for the encoding.
+struct InstPattern
+{
+    uint32_t match;
+    uint32_t mask;
+    InstEnum name;
+    InstFormat format;
+    uint32_t ext;
+
+    constexpr bool matches(uint32_t code) const
+    {
+        return (code & mask) == match;
+    }
+
+    // rejected encodings stop the search and are reported as unknown
+    constexpr bool is_reject() const
+    {
+        return name == UNKNOWN && format == InstFormat::UNKNOWN;
+    }
+
+    constexpr bool enabled_in(uint32_t isa) const
+    {
+        return (ext & isa) == ext;
+    }
+};
+
+constexpr InstPattern reject(uint32_t match, uint32_t mask, uint32_t ext)
+{
+    return InstPattern{match, mask, UNKNOWN, InstFormat::UNKNOWN, ext};
+}
+
+// clang-format off
+inline constexpr InstPattern inst_patterns[] = {
+    // RVC quadrant 0
+    {0x00000000, 0x0000e003, C_ADDI4SPN, InstFormat::CIW, ISA_C},
+    {0x00002000, 0x0000e003, C_FLD, InstFormat::CL, ISA_C | ISA_D},
+    {0x00004000, 0x0000e003, C_LW, InstFormat::CL, ISA_C},
+    {0x00006000, 0x0000e003, C_LD, InstFormat::CL, ISA_C},
+    reject(0x00008000, 0x0000e003, ISA_C),
+    {0x0000a000, 0x0000e003, C_FSD, InstFormat::CS, ISA_C | ISA_D},
+    {0x0000c000, 0x0000e003, C_SW, InstFormat::CS, ISA_C},
+    {0x0000e000, 0x0000e003, C_SD, InstFormat::CS, ISA_C},
+
+    // RVC quadrant 1
+    {0x00000001, 0x0000ef83, C_NOP, InstFormat::CI, ISA_C},
+    {0x00000001, 0x0000e003, C_ADDI, InstFormat::CI, ISA_C},
+    {0x00002001, 0x0000e003, C_ADDIW, InstFormat::CI, ISA_C},
+    {0x00004001, 0x0000e003, C_LI, InstFormat::CI, ISA_C},
+    {0x00006101, 0x0000ef83, C_ADDI16SP, InstFormat::CI, ISA_C},
+    reject(0x00006001, 0x0000ef83, ISA_C),
+    {0x00006001, 0x0000e003, C_LUI, InstFormat::CI, ISA_C},
+    {0x00008001, 0x0000ec03, C_SRLI, InstFormat::CB, ISA_C},
+    {0x00008401, 0x0000ec03, C_SRAI, InstFormat::CB, ISA_C},
+    {0x00008801, 0x0000ec03, C_ANDI, InstFormat::CB, ISA_C},
+    {0x00008c01, 0x0000ec63, C_SUB, InstFormat::CA, ISA_C},
+    {0x00008c21, 0x0000ec63, C_XOR, InstFormat::CA, ISA_C},
+    {0x00008c41, 0x0000ec63, C_OR, InstFormat::CA, ISA_C},
+    {0x00008c61, 0x0000ec63, C_AND, InstFormat::CA, ISA_C},
+    {0x0000a001, 0x0000e003, C_J, InstFormat::CJ, ISA_C},
+    {0x0000c001, 0x0000e003, C_BEQZ, InstFormat::CB, ISA_C},
+    {0x0000e001, 0x0000e003, C_BNEZ, InstFormat::CB, ISA_C},
+
+    // RVC quadrant 2
+    {0x00000002, 0x0000e003, C_SLLI, InstFormat::CI, ISA_C},
+    {0x00002002, 0x0000e003, C_FLDSP, InstFormat::CI, ISA_C | ISA_D},
+    {0x00004002, 0x0000e003, C_LWSP, InstFormat::CI, ISA_C},
+    {0x00006002, 0x0000e003, C_LDSP, InstFormat::CI, ISA_C},
+    {0x00009002, 0x0000ffff, C_EBREAK, InstFormat::CR, ISA_C},
+    reject(0x00009002, 0x0000ff83, ISA_C),
+    {0x00009002, 0x0000f07f, C_JALR, InstFormat::CA, ISA_C},
+    {0x00009002, 0x0000f003, C_ADD, InstFormat::CR, ISA_C},
+    {0x00008002, 0x0000f07f, C_JR, InstFormat::CR, ISA_C},
+    {0x00008002, 0x0000f003, C_MV, InstFormat::CR, ISA_C},
+    {0x0000a002, 0x0000e003, C_FSDSP, InstFormat::CSS, ISA_C | ISA_D},
+    {0x0000c002, 0x0000e003, C_SWSP, InstFormat::CSS, ISA_C},
+    {0x0000e002, 0x0000e003, C_SDSP, InstFormat::CSS, ISA_C},
+
+    // loads
+    {0x00000003, 0x0000707f, LB, InstFormat::I, ISA_I},
+    {0x00001003, 0x0000707f, LH, InstFormat::I, ISA_I},
+    {0x00002003, 0x0000707f, LW, InstFormat::I, ISA_I},
+    {0x00003003, 0x0000707f, LD, InstFormat::I, ISA_I},
+    {0x00004003, 0x0000707f, LBU, InstFormat::I, ISA_I},
+    {0x00005003, 0x0000707f, LHU, InstFormat::I, ISA_I},
+    {0x00006003, 0x0000707f, LWU, InstFormat::I, ISA_I},
+
+    // FP loads/stores share their opcodes with RVV loads/stores, which always
+    // come with F in practice; not decoded yet
+    {0x00000007, 0x0000007f, LOAD_PLACEHOLDER, InstFormat::UNKNOWN, ISA_F},
+    {0x00000027, 0x0000007f, STORE_PLACEHOLDER, InstFormat::UNKNOWN, ISA_F},
+
+    {0x0000000f, 0x0000007f, FENCE, InstFormat::I, ISA_I},
+    {0x00000013, 0x0000007f, ADDI, InstFormat::I, ISA_I},
+    {0x00000017, 0x0000007f, AUIPC, InstFormat::U, ISA_I},
+    {0x0000001b, 0x0000707f, ADDIW, InstFormat::I, ISA_I},
+    {0x0000101b, 0x0000707f, SLLIW, InstFormat::I, ISA_I},
+    {0x0000501b, 0x0000707f, SLRIW_SAIW, InstFormat::I, ISA_I},
+    {0x00000023, 0x0000007f, SD, InstFormat::S, ISA_I},
+    {0x0000002f, 0x0000007f, LR, InstFormat::R, ISA_A},
+    {0x00000033, 0x0000007f, ADD, InstFormat::R, ISA_I},
+    {0x00000037, 0x0000007f, LUI, InstFormat::U, ISA_I},
+    {0x0000003b, 0x0000007f, SUBW, InstFormat::R, ISA_I},
+    {0x00000043, 0x0000007f, FMADD, InstFormat::R_4, ISA_F},
+    {0x0000004b, 0x0000007f, FNMSUB, InstFormat::R_4, ISA_F},
+    {0x00000053, 0x0000007f, FMV, InstFormat::R, ISA_F},
+
+    // branches
+    {0x00000063, 0x0000707f, BEQ, InstFormat::B, ISA_I},
+    {0x00001063, 0x0000707f, BNE, InstFormat::B, ISA_I},
+    {0x00004063, 0x0000707f, BLT, InstFormat::B, ISA_I},
+    {0x00005063, 0x0000707f, BGE, InstFormat::B, ISA_I},
+    {0x00006063, 0x0000707f, BLTU, InstFormat::B, ISA_I},
+    {0x00007063, 0x0000707f, BGEU, InstFormat::B, ISA_I},
+    {0x00000063, 0x0000007f, UNKNOWN, InstFormat::B, ISA_I},
+
+    {0x00000067, 0x0000007f, JALR, InstFormat::I, ISA_I},
+    {0x0000006f, 0x0000007f, JAL, InstFormat::J, ISA_I},
+    // SYSTEM is listed as CSRRS throughout; funct3 0 (ecall, ebreak, xret,
+    // wfi) is base ISA, the other funct3 values are the Zicsr instructions
+    {0x00000073, 0x0000707f, CSRRS, InstFormat::UNKNOWN, ISA_I},
+    {0x00000073, 0x0000007f, CSRRS, InstFormat::UNKNOWN, ISA_ZICSR},
+
+    // RVV configuration
+    {0x00007057, 0x8000707f, V_VSETVLI, InstFormat::OPCFG, ISA_V},
+    {0x80007057, 0xc000707f, V_VSETVL, InstFormat::OPCFG, ISA_V},
+    {0xc0007057, 0xc000707f, V_VSETIVLI, InstFormat::OPCFG, ISA_V},
+
+    // RVV arithmetic, funct6 in bits 31:26
+    // OPIVV
+    {0x00000057, 0xfc00707f, V_ADD, InstFormat::OPIVV, ISA_V},
+    {0x08000057, 0xfc00707f, V_SUB, InstFormat::OPIVV, ISA_V},
+    {0x0c000057, 0xfc00707f, V_RSUB, InstFormat::OPIVV, ISA_V},
+    {0x30000057, 0xfc00707f, V_SLIDEDOWN, InstFormat::OPIVV, ISA_V},
+    {0x3c000057, 0xfc00707f, V_RGATHER, InstFormat::OPIVV, ISA_V},
+    {0x5c000057, 0xfc00707f, V_MERGE, InstFormat::OPIVV, ISA_V},
+    {0x94000057, 0xfc00707f, V_SLL, InstFormat::OPIVV, ISA_V},
+    {0x9c000057, 0xfc00707f, V_SMUL, InstFormat::OPIVV, ISA_V},
+    {0x00000057, 0x0000707f, UNKNOWN, InstFormat::OPIVV, ISA_V},
+    // OPIVX
+    {0x00004057, 0xfc00707f, V_ADD, InstFormat::OPIVX, ISA_V},
+    {0x08004057, 0xfc00707f, V_SUB, InstFormat::OPIVX, ISA_V},
+    {0x0c004057, 0xfc00707f, V_RSUB, InstFormat::OPIVX, ISA_V},
+    {0x30004057, 0xfc00707f, V_SLIDEDOWN, InstFormat::OPIVX, ISA_V},
+    {0x3c004057, 0xfc00707f, V_RGATHER, InstFormat::OPIVX, ISA_V},
+    {0x5c004057, 0xfc00707f, V_MERGE, InstFormat::OPIVX, ISA_V},
+    {0x94004057, 0xfc00707f, V_SLL, InstFormat::OPIVX, ISA_V},
+    {0x9c004057, 0xfc00707f, V_SMUL, InstFormat::OPIVX, ISA_V},
+    {0x00004057, 0x0000707f, UNKNOWN, InstFormat::OPIVX, ISA_V},
+    // OPIVI
+    {0x00003057, 0xfc00707f, V_ADD, InstFormat::OPIVI, ISA_V},
+    {0x08003057, 0xfc00707f, V_SUB, InstFormat::OPIVI, ISA_V},
+    {0x0c003057, 0xfc00707f, V_RSUB, InstFormat::OPIVI, ISA_V},
+    {0x30003057, 0xfc00707f, V_SLIDEDOWN, InstFormat::OPIVI, ISA_V},
+    {0x3c003057, 0xfc00707f, V_RGATHER, InstFormat::OPIVI, ISA_V},
+    {0x5c003057, 0xfc00707f, V_MERGE, InstFormat::OPIVI, ISA_V},
+    {0x94003057, 0xfc00707f, V_SLL, InstFormat::OPIVI, ISA_V},
+    {0x9c003057, 0xfc00707f, V_SMUL, InstFormat::OPIVI, ISA_V},
+    {0x00003057, 0x0000707f, UNKNOWN, InstFormat::OPIVI, ISA_V},
+    // OPMVV
+    {0x00002057, 0xfc00707f, V_REDSUM, InstFormat::OPMVV, ISA_V},
+    {0xb4002057, 0xfc00707f, V_MACC, InstFormat::OPMVV, ISA_V},
+    {0x40002057, 0xfc0ff07f, V_MV_X_S, InstFormat::OPMVV, ISA_V},
+    {0x40082057, 0xfc0ff07f, V_POPC, InstFormat::OPMVV, ISA_V},
+    {0x4008a057, 0xfc0ff07f, V_FIRST, InstFormat::OPMVV, ISA_V},
+    reject(0x40002057, 0xfc00707f, ISA_V),
+    {0x5000a057, 0xfc0ff07f, V_MSBF, InstFormat::OPMVV, ISA_V},
+    {0x50012057, 0xfc0ff07f, V_MSOF, InstFormat::OPMVV, ISA_V},
+    {0x5001a057, 0xfc0ff07f, V_MSIF, InstFormat::OPMVV, ISA_V},
+    {0x50082057, 0xfc0ff07f, V_IOTA, InstFormat::OPMVV, ISA_V},
+    {0x5008a057, 0xfc0ff07f, V_ID_V, InstFormat::OPMVV, ISA_V},
+    {0x00002057, 0x0000707f, UNKNOWN, InstFormat::OPMVV, ISA_V},
+    // OPMVX
+    {0x00006057, 0xfc00707f, V_REDSUM, InstFormat::OPMVX, ISA_V},
+    {0xb4006057, 0xfc00707f, V_MACC, InstFormat::OPMVX, ISA_V},
+    {0x40006057, 0xfdf0707f, V_MV_S_X, InstFormat::OPMVX, ISA_V},
+    reject(0x40006057, 0xfc00707f, ISA_V),
+    {0x00006057, 0x0000707f, UNKNOWN, InstFormat::OPMVX, ISA_V},
+    // OPFVV
+    {0x00001057, 0xfc00707f, V_FADD, InstFormat::OPFVV, ISA_V},
+    {0x04001057, 0xfc00707f, V_FREDUSUM, InstFormat::OPFVV, ISA_V},
+    {0x0c001057, 0xfc00707f, V_FREDOSUM, InstFormat::OPFVV, ISA_V},
+    {0x40001057, 0xfdf0707f, V_FMV_S_F, InstFormat::OPFVV, ISA_V},
+    {0x40001057, 0xfc0ff07f, V_FMV_F_S, InstFormat::OPFVV, ISA_V},
+    {0x5c001057, 0xfc00707f, V_FMV, InstFormat::OPFVV, ISA_V},
+    {0x70001057, 0xfc00707f, V_MFNE, InstFormat::OPFVV, ISA_V},
+    {0x90001057, 0xfc00707f, V_FMUL, InstFormat::OPFVV, ISA_V},
+    {0xac001057, 0xfc00707f, V_FNMSUB, InstFormat::OPFVV, ISA_V},
+    {0xb0001057, 0xfc00707f, V_FMACC, InstFormat::OPFVV, ISA_V},
+    {0xbc001057, 0xfc00707f, V_FNMSAC, InstFormat::OPFVV, ISA_V},
+    // OPFVF
+    {0x00005057, 0xfc00707f, V_FADD, InstFormat::OPFVF, ISA_V},
+    {0x04005057, 0xfc00707f, V_FREDUSUM, InstFormat::OPFVF, ISA_V},
+    {0x0c005057, 0xfc00707f, V_FREDOSUM, InstFormat::OPFVF, ISA_V},
+    {0x40005057, 0xfdf0707f, V_FMV_S_F, InstFormat::OPFVF, ISA_V},
+    {0x40005057, 0xfc0ff07f, V_FMV_F_S, InstFormat::OPFVF, ISA_V},
+    {0x5c005057, 0xfc00707f, V_FMV, InstFormat::OPFVF, ISA_V},
+    {0x70005057, 0xfc00707f, V_MFNE, InstFormat::OPFVF, ISA_V},
+    {0x90005057, 0xfc00707f, V_FMUL, InstFormat::OPFVF, ISA_V},
+    {0xac005057, 0xfc00707f, V_FNMSUB, InstFormat::OPFVF, ISA_V},
+    {0xb0005057, 0xfc00707f, V_FMACC, InstFormat::OPFVF, ISA_V},
+    {0xbc005057, 0xfc00707f, V_FNMSAC, InstFormat::OPFVF, ISA_V},
+};
+// clang-format on
+
+constexpr bool patterns_well_formed(const auto &patterns)
+{
+    for (const InstPattern &pattern : patterns)
+    {
+        // every pattern fixes the length bits, and match only uses masked bits
+        if ((pattern.match & ~pattern.mask) != 0 || (pattern.mask & 0x3) != 0x3)
+            return false;
+    }
+    return true;
+}
+
+static_assert(patterns_well_formed(inst_patterns), "pattern match bits must lie inside the mask");
+
+constexpr std::size_t count_patterns(uint32_t isa)
+{
+    std::size_t count = 0;
+    for (const InstPattern &pattern : inst_patterns)
+        count += pattern.enabled_in(isa);
+    return count;
+}
+
+// inst_patterns restricted to the extensions in Isa, in the same order
+template <uint32_t Isa>
+inline constexpr auto isa_patterns = []
+{
+    std::array<InstPattern, count_patterns(Isa)> result{};
+    std::size_t next = 0;
+    for (const InstPattern &pattern : inst_patterns)
+        if (pattern.enabled_in(Isa))
+            result[next++] = pattern;
+    return result;
+}();
+
+// Compile-time dispatch over a pattern table. The first level is a direct
+// index on the bits nearly every pattern fixes: opcode[6:2] and funct3 for
+// 32-bit words, quadrant and funct3 for compressed ones. Each of the 288
+// buckets lists, in table order, only the patterns that can match words
+// of that bucket, so most words are decided by a single compare.
+template <const auto &Patterns>
+class PatternDecoder
+{
+private:
+    static constexpr std::size_t uncompressed_buckets = 256;
+    static constexpr std::size_t bucket_count = uncompressed_buckets + 32;
+
+    static constexpr uint32_t bucket_of(uint32_t code)
+    {
+        if ((code & 0x3) == 0x3)
+            return ((code >> 2) & 0x1f) | ((code >> 12) & 0x7) << 5;
+        return uncompressed_buckets + ((code & 0x3) | ((code >> 13) & 0x7) << 2);
+    }
+
+    // a word with exactly the key bits of the bucket set
+    static constexpr uint32_t bucket_key(std::size_t bucket)
+    {
+        if (bucket < uncompressed_buckets)
+            return 0x3 | (bucket & 0x1f) << 2 | (bucket >> 5) << 12;
+        bucket -= uncompressed_buckets;
+        return (bucket & 0x3) | (bucket >> 2) << 13;
+    }
+
+    static constexpr uint32_t bucket_key_mask(std::size_t bucket)
+    {
+        return bucket < uncompressed_buckets ? 0x707f : 0xe003;
+    }
+
+    static constexpr bool in_bucket(const InstPattern &pattern, std::size_t bucket)
+    {
+        uint32_t key_mask = bucket_key_mask(bucket) & pattern.mask;
+        return ((bucket_key(bucket) ^ pattern.match) & key_mask) == 0;
+    }
+
+    static constexpr std::size_t entry_count = []
+    {
+        std::size_t count = 0;
+        for (std::size_t bucket = 0; bucket < bucket_count; bucket++)
+            for (const InstPattern &pattern : Patterns)
+                count += in_bucket(pattern, bucket);
+        return count;
+    }();
+
+    struct Dispatch
+    {
+        std::array<uint16_t, bucket_count + 1> offsets;
+        std::array<uint16_t, entry_count> indices;
+    };
+
+    static constexpr Dispatch dispatch = []
+    {
+        Dispatch result{};
+        std::size_t next = 0;
+        for (std::size_t bucket = 0; bucket < bucket_count; bucket++)
+        {
+            result.offsets[bucket] = next;
+            for (std::size_t i = 0; i < std::size(Patterns); i++)
+                if (in_bucket(Patterns[i], bucket))
+                    result.indices[next++] = i;
+        }
+        result.offsets[bucket_count] = next;
+        return result;
+    }();
+
+public:
+    // first pattern matching code, or nullptr
+    static const InstPattern *match(uint32_t code)
+    {
+        const uint32_t bucket = bucket_of(code);
+        for (uint32_t i = dispatch.offsets[bucket]; i < dispatch.offsets[bucket + 1]; i++)
+        {
+            const InstPattern &pattern = Patterns[dispatch.indices[i]];
+            if (pattern.matches(code))
+                return &pattern;
+        }
+        return nullptr;
+    }
+};
+
+#endif
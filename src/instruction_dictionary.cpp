@@ -0,0 +1,133 @@
+#include "instruction_dictionary.hpp"
+#include "line_parse.hpp"
+
+static constexpr unsigned initial_bits = 12;
+
+InstructionDictionary::InstructionDictionary(const IsaDecoder &decoder)
+    : m_decoder(&decoder), m_slots(std::size_t(1) << initial_bits), m_shift(32 - initial_bits)
+{
+}
+
+uint32_t &InstructionDictionary::slot_for(uint32_t code)
+{
+    const std::size_t mask = m_slots.size() - 1;
+    // Fibonacci hashing, as in DecodeCache
+    std::size_t index = (code * 0x9e3779b1u) >> m_shift;
+    while (m_slots[index] && m_codes[m_slots[index] - 1] != code)
+        index = (index + 1) & mask;
+    return m_slots[index];
+}
+
+void InstructionDictionary::grow()
+{
+    m_slots.assign(m_slots.size() * 2, 0);
+    m_shift--;
+    for (uint32_t id = 0; id < m_codes.size(); id++)
+        slot_for(m_codes[id]) = id + 1;
+}
+
+uint32_t InstructionDictionary::intern(uint32_t code)
+{
+    uint32_t &slot = slot_for(code);
+    if (slot)
+        return slot - 1;
+
+    const uint32_t id = static_cast<uint32_t>(m_codes.size());
+    slot = id + 1;
+    m_codes.push_back(code);
+
+    DecodedInstruction inst{};
+    m_decoder->try_decode(code, inst);
+    m_insts.push_back(inst);
+
+    DecodeCounts unused;
+    m_render.clear();
+    print_listing_line(inst, m_render, unused);
+    m_listing += m_render.view();
+    m_listing_offsets.push_back(static_cast<uint32_t>(m_listing.size()));
+
+    // keep the table at most half full
+    if (m_codes.size() * 2 > m_slots.size())
+        grow();
+    return id;
+}
+
+std::size_t InstructionDictionary::memory_usage() const
+{
+    return m_slots.capacity() * sizeof(uint32_t) + m_codes.capacity() * sizeof(uint32_t) +
+           m_insts.capacity() * sizeof(DecodedInstruction) + m_listing.capacity() +
+           m_listing_offsets.capacity() * sizeof(uint32_t);
+}
+
+void intern_lines(std::string_view lines, const DecodeConfig &config, InternedTrace &trace, DecodeCounts &counts)
+{
+    InstructionDictionary &dictionary = trace.dictionary;
+    while (!lines.empty())
+    {
+        std::size_t eol = lines.find('\n');
+        std::string_view line = lines.substr(0, eol);
+        lines.remove_prefix(eol == std::string_view::npos ? lines.size() : eol + 1);
+
+        uint32_t code;
+        if (!try_extract_instruction_from_line(line, code))
+        {
+            if (config.strict)
+                fail_line(DecodeStatus::NO_INSTRUCTION, 0, line);
+            counts.bad_lines++;
+            continue;
+        }
+
+        const std::size_t known_words = dictionary.size();
+        const uint32_t id = dictionary.intern(code);
+        // an unknown word fails on its first occurrence
+        if (config.strict && dictionary.size() != known_words && !dictionary.instruction(id).is_known())
+            fail_line(DecodeStatus::UNKNOWN_ENCODING, code, line);
+        trace.ids.push_back(id);
+        if (trace.keep_pcs)
+        {
+            TraceRecord record;
+            trace.pcs.push_back(parse_trace_record(line, record) ? record.pc : 0);
+        }
+    }
+}
+
+std::vector<uint64_t> count_occurrences(const InternedTrace &trace)
+{
+    std::vector<uint64_t> occurrences(trace.dictionary.size());
+    for (uint32_t id : trace.ids)
+        occurrences[id]++;
+    return occurrences;
+}
+
+void add_interned_counts(const InternedTrace &trace, const std::vector<uint64_t> &occurrences, DecodeCounts &counts)
+{
+    const InstructionDictionary &dictionary = trace.dictionary;
+    for (uint32_t id = 0; id < dictionary.size(); id++)
+    {
+        if (!occurrences[id])
+            continue;
+        const DecodedInstruction &inst = dictionary.instruction(id);
+        if (inst.compressed)
+            counts.count_compressed += occurrences[id];
+        // IDs follow first appearance, so the histogram keeps the same
+        // example words as a line by line run
+        if (!inst.is_known())
+            counts.unknown.record(dictionary.code(id), occurrences[id]);
+    }
+    counts.count += trace.ids.size();
+}
+
+void write_interned_listing(const InternedTrace &trace, OutputBuffer &out, DecodeCounts &counts)
+{
+    const InstructionDictionary &dictionary = trace.dictionary;
+
+    // per-ID occurrence counts turn the per-instruction bookkeeping into
+    // one pass over the dictionary
+    std::vector<uint64_t> occurrences(dictionary.size());
+    for (uint32_t id : trace.ids)
+    {
+        out.write(dictionary.listing(id));
+        occurrences[id]++;
+    }
+    add_interned_counts(trace, occurrences, counts);
+}
@@ -0,0 +1,87 @@
+#ifndef INSTRUCTION_DICTIONARY_HPP
+#define INSTRUCTION_DICTIONARY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "chunk_decoder.hpp"
+#include "decoder.hpp"
+#include "instructions.hpp"
+
+// Every distinct instruction word of a trace, decoded and rendered once.
+// IDs are dense and handed out in order of first appearance, so per-word
+// data can live in plain vectors indexed by ID.
+class InstructionDictionary
+{
+private:
+    const IsaDecoder *m_decoder;
+    // open addressing with linear probing; a slot holds ID + 1, 0 is empty
+    std::vector<uint32_t> m_slots;
+    uint32_t m_shift;
+    std::vector<uint32_t> m_codes;
+    std::vector<DecodedInstruction> m_insts;
+    // listing line of ID i is m_listing[m_listing_offsets[i], m_listing_offsets[i + 1])
+    std::string m_listing;
+    std::vector<uint32_t> m_listing_offsets{0};
+    OutputBuffer m_render;
+
+    uint32_t &slot_for(uint32_t code);
+    void grow();
+
+public:
+    explicit InstructionDictionary(const IsaDecoder &decoder);
+
+    // ID of code; the first time a word is seen it is decoded and its
+    // listing line rendered
+    uint32_t intern(uint32_t code);
+
+    std::size_t size() const { return m_codes.size(); }
+
+    uint32_t code(uint32_t id) const { return m_codes[id]; }
+
+    const DecodedInstruction &instruction(uint32_t id) const { return m_insts[id]; }
+
+    // "<code> <mnemonic> <operands>\n", exactly as print_listing_line writes it
+    std::string_view listing(uint32_t id) const
+    {
+        return std::string_view(m_listing).substr(m_listing_offsets[id], m_listing_offsets[id + 1] - m_listing_offsets[id]);
+    }
+
+    // bytes held by the dictionary itself
+    std::size_t memory_usage() const;
+};
+
+// A trace held in memory as one 4-byte ID per executed instruction instead
+// of a decoded instruction per line.
+struct InternedTrace
+{
+    InstructionDictionary dictionary;
+    std::vector<uint32_t> ids;
+    // pc of every ID, only filled with keep_pcs (for the Arrow export);
+    // text lines without the "core N:" prefix get pc 0
+    bool keep_pcs = false;
+    std::vector<uint64_t> pcs;
+
+    explicit InternedTrace(const IsaDecoder &decoder) : dictionary(decoder) {}
+};
+
+// Appends the words of a block of text lines. Lines without an instruction
+// are counted in counts.bad_lines; with config.strict they throw, as does
+// the first unknown encoding.
+void intern_lines(std::string_view lines, const DecodeConfig &config, InternedTrace &trace, DecodeCounts &counts);
+
+// How often each ID occurs in the trace.
+std::vector<uint64_t> count_occurrences(const InternedTrace &trace);
+
+// Counts instructions, compressed ones and unknown encodings from the
+// per-ID occurrences, one pass over the dictionary.
+void add_interned_counts(const InternedTrace &trace, const std::vector<uint64_t> &occurrences, DecodeCounts &counts);
+
+// Writes the listing of the whole trace by copying each ID's rendered line,
+// and counts it with add_interned_counts.
+void write_interned_listing(const InternedTrace &trace, OutputBuffer &out, DecodeCounts &counts);
+
+#endif
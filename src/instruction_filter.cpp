@@ -0,0 +1,117 @@
+#include <cctype>
+#include <stdexcept>
+#include <string>
+
+#include "instruction_filter.hpp"
+#include "isa.hpp"
+#include "line_parse.hpp"
+
+static bool equal_ignore_case(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+    {
+        if (std::toupper(static_cast<unsigned char>(a[i])) != std::toupper(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+// calls add(item) for every non-empty item of a comma separated list
+template <typename Add>
+static void for_each_item(std::string_view list, Add add)
+{
+    while (!list.empty())
+    {
+        const std::size_t comma = list.find(',');
+        const std::string_view item = list.substr(0, comma);
+        if (!item.empty())
+            add(item);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+    }
+}
+
+// sets the bits of every name in names that item selects
+template <std::size_t N>
+static void select_names(std::string_view item, const std::array<std::string_view, N> &names, std::bitset<N> &selected,
+                         const char *what)
+{
+    const bool prefix = item.ends_with('*');
+    const std::string_view key = prefix ? item.substr(0, item.size() - 1) : item;
+    bool found = false;
+    for (std::size_t i = 0; i < N; i++)
+    {
+        const std::string_view name = prefix ? names[i].substr(0, key.size()) : names[i];
+        if (equal_ignore_case(name, key))
+        {
+            selected.set(i);
+            found = true;
+        }
+    }
+    if (!found)
+        throw std::runtime_error(std::string("Unknown ") + what + ": " + std::string(item));
+}
+
+void InstructionFilter::add_mnemonics(std::string_view list)
+{
+    for_each_item(list, [&](std::string_view item)
+                  { select_names(item, insts_mnem_map, m_mnemonics, "mnemonic"); });
+    m_by_mnemonic = true;
+}
+
+void InstructionFilter::add_formats(std::string_view list)
+{
+    for_each_item(list, [&](std::string_view item)
+                  { select_names(item, InstructionFormatStringMap, m_formats, "format"); });
+    m_by_format = true;
+}
+
+void InstructionFilter::add_extensions(std::string_view list)
+{
+    for_each_item(list, [&](std::string_view item)
+                  { m_extensions |= parse_extension(item); });
+}
+
+void InstructionFilter::set_pc_range(uint64_t first, uint64_t last)
+{
+    m_pc_first = first;
+    m_pc_last = last;
+    m_by_pc = true;
+}
+
+bool InstructionFilter::accepts_identity(uint32_t code, const IsaDecoder &decoder) const
+{
+    if (!m_by_mnemonic && !m_by_format && !m_extensions)
+        return true;
+
+    InstIdentity identity;
+    decoder.identify(code, identity);
+    if (m_by_mnemonic && !m_mnemonics.test(identity.name))
+        return false;
+    if (m_by_format && !m_formats.test(static_cast<std::size_t>(identity.format)))
+        return false;
+    return !m_extensions || (identity.ext & m_extensions);
+}
+
+bool InstructionFilter::accepts_line(uint32_t code, std::string_view line, const IsaDecoder &decoder) const
+{
+    if (!accepts_word(code))
+        return false;
+    if (m_by_pc)
+    {
+        uint64_t pc;
+        if (!try_extract_pc_from_line(line, pc) || pc < m_pc_first || pc >= m_pc_last)
+            return false;
+    }
+    return accepts_identity(code, decoder);
+}
+
+bool InstructionFilter::accepts(uint32_t code, uint64_t pc, const IsaDecoder &decoder) const
+{
+    if (!accepts_word(code))
+        return false;
+    if (m_by_pc && (pc < m_pc_first || pc >= m_pc_last))
+        return false;
+    return accepts_identity(code, decoder);
+}
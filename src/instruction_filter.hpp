@@ -0,0 +1,76 @@
+#ifndef INSTRUCTION_FILTER_HPP
+#define INSTRUCTION_FILTER_HPP
+
+#include <bitset>
+#include <cstdint>
+#include <string_view>
+
+#include "decoder.hpp"
+#include "instructions.hpp"
+
+// Selects instructions by mnemonic, format, extension, pc range and
+// compressed flag. The checks run cheapest first: the compressed bit of the
+// word, then the pc, then one pattern match for the rest. A rejected word
+// is never decoded any further, so only the instructions that pass pay for
+// operand decoding and formatting.
+class InstructionFilter
+{
+private:
+    enum class Compressed : uint8_t
+    {
+        ANY,
+        ONLY,
+        NEVER,
+    };
+
+    std::bitset<INST_ENUM_COUNT> m_mnemonics;
+    std::bitset<static_cast<std::size_t>(InstFormat::COUNT)> m_formats;
+    uint32_t m_extensions = 0;
+    bool m_by_mnemonic = false;
+    bool m_by_format = false;
+    bool m_by_pc = false;
+    uint64_t m_pc_first = 0;
+    uint64_t m_pc_last = UINT64_MAX;
+    Compressed m_compressed = Compressed::ANY;
+
+    bool accepts_word(uint32_t code) const
+    {
+        if (m_compressed == Compressed::ANY)
+            return true;
+        return ((code & 0x3) != 0x3) == (m_compressed == Compressed::ONLY);
+    }
+
+    bool accepts_identity(uint32_t code, const IsaDecoder &decoder) const;
+
+public:
+    // Comma separated mnemonics as listed, case-insensitive; a trailing '*'
+    // matches every mnemonic with that prefix ("V_*"). Throws for names
+    // that match nothing.
+    void add_mnemonics(std::string_view list);
+
+    // comma separated format names, e.g. "CI,CR"
+    void add_formats(std::string_view list);
+
+    // comma separated extensions, e.g. "v,zicsr"; an instruction passes if
+    // its encoding needs any of them
+    void add_extensions(std::string_view list);
+
+    // [first, last)
+    void set_pc_range(uint64_t first, uint64_t last);
+
+    void set_compressed(bool compressed) { m_compressed = compressed ? Compressed::ONLY : Compressed::NEVER; }
+
+    bool is_active() const
+    {
+        return m_by_mnemonic || m_by_format || m_extensions || m_by_pc || m_compressed != Compressed::ANY;
+    }
+
+    // For a trace line; the pc is only parsed out of line with a pc range
+    // set, and lines without one are rejected then.
+    bool accepts_line(uint32_t code, std::string_view line, const IsaDecoder &decoder) const;
+
+    // for input that carries the pc separately (.rvtb)
+    bool accepts(uint32_t code, uint64_t pc, const IsaDecoder &decoder) const;
+};
+
+#endif
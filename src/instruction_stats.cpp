@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+#include "instruction_stats.hpp"
+#include "line_parse.hpp"
+
+// lines per decode_batch call, as in decode_chunk
+static constexpr std::size_t batch_size = 4096;
+
+// major opcode names from the RISC-V base opcode map; the reserved and
+// longer-encoding slots are told apart by their opcode
+static constexpr std::array<std::string_view, opcode_class_count> opcode_class_names = {
+    "LOAD", "LOAD-FP", "custom-0", "MISC-MEM", "OP-IMM", "AUIPC", "OP-IMM-32", "48b-0x1f",
+    "STORE", "STORE-FP", "custom-1", "AMO", "OP", "LUI", "OP-32", "64b-0x3f",
+    "MADD", "MSUB", "NMSUB", "NMADD", "OP-FP", "OP-V", "custom-2", "48b-0x5f",
+    "BRANCH", "JALR", "reserved-0x6b", "JAL", "SYSTEM", "reserved-0x77", "custom-3", "80b-0x7f",
+    "C0", "C1", "C2"};
+
+std::string_view opcode_class_name(std::size_t opcode_class)
+{
+    return opcode_class_names[opcode_class];
+}
+
+void InstructionStats::merge(const InstructionStats &other)
+{
+    for (std::size_t i = 0; i < by_mnemonic.size(); i++)
+        by_mnemonic[i] += other.by_mnemonic[i];
+    for (std::size_t i = 0; i < by_format.size(); i++)
+        by_format[i] += other.by_format[i];
+    for (std::size_t i = 0; i < by_opcode_class.size(); i++)
+        by_opcode_class[i] += other.by_opcode_class[i];
+    compressed += other.compressed;
+    uncompressed += other.uncompressed;
+}
+
+void collect_stats_chunk(std::string_view chunk, const DecodeConfig &config, InstructionStats &stats,
+                         DecodeCounts &counts)
+{
+    std::vector<std::string_view> lines;
+    std::vector<uint32_t> codes;
+    lines.reserve(batch_size);
+    codes.reserve(batch_size);
+    std::vector<DecodedInstruction> insts(batch_size);
+
+    auto flush = [&]()
+    {
+        const std::size_t unknown = config.decoder->decode_batch(codes, insts);
+        add_stats_batch(std::span(insts).first(codes.size()), unknown, config, [&](std::size_t i)
+                        { return lines[i]; }, stats, counts);
+        lines.clear();
+        codes.clear();
+    };
+
+    while (!chunk.empty())
+    {
+        while (!chunk.empty() && codes.size() < batch_size)
+        {
+            std::size_t eol = chunk.find('\n');
+            std::string_view line = chunk.substr(0, eol);
+            chunk.remove_prefix(eol == std::string_view::npos ? chunk.size() : eol + 1);
+            uint32_t code;
+            if (!try_extract_instruction_from_line(line, code))
+            {
+                // nothing is listed, so only a strict error ends the batch,
+                // after counting the lines before it
+                if (config.strict)
+                {
+                    flush();
+                    fail_line(DecodeStatus::NO_INSTRUCTION, 0, line);
+                }
+                counts.bad_lines++;
+                continue;
+            }
+            if (config.rejects_line(code, line))
+            {
+                counts.filtered++;
+                continue;
+            }
+            lines.push_back(line);
+            codes.push_back(code);
+        }
+        flush();
+    }
+}
+
+void collect_stats(std::string_view data, const DecodeConfig &config, unsigned jobs, InstructionStats &stats,
+                   DecodeCounts &counts, const progress_callback_t &progress)
+{
+    const std::vector<std::size_t> bounds = split_into_chunks(data);
+    const std::size_t chunk_count = bounds.size() - 1;
+
+    // one padded InstructionStats per thread; the histograms only add up,
+    // so it does not matter which thread took which chunk
+    struct alignas(cache_line_size) Worker
+    {
+        InstructionStats stats;
+    };
+    // DecodeCounts per chunk instead, merged in chunk order so the unknown
+    // encoding report keeps the first example of the trace, as serially
+    struct alignas(cache_line_size) ChunkResult
+    {
+        DecodeCounts counts;
+        std::exception_ptr error;
+    };
+    std::vector<Worker> workers(std::max(1u, jobs));
+    std::vector<ChunkResult> results(chunk_count);
+    std::atomic<std::size_t> next_chunk{0};
+    std::atomic<std::size_t> done_bytes{0};
+    // lowest chunk that threw; chunks below it are still decoded so the
+    // error rethrown is the one of the first bad line
+    std::atomic<std::size_t> failed_chunk{SIZE_MAX};
+
+    auto work = [&](Worker &worker, bool report)
+    {
+        for (;;)
+        {
+            const std::size_t idx = next_chunk.fetch_add(1, std::memory_order_relaxed);
+            if (idx >= chunk_count || idx > failed_chunk.load(std::memory_order_relaxed))
+                return;
+            try
+            {
+                collect_stats_chunk(data.substr(bounds[idx], bounds[idx + 1] - bounds[idx]), config, worker.stats,
+                                    results[idx].counts);
+            }
+            catch (...)
+            {
+                results[idx].error = std::current_exception();
+                std::size_t failed = failed_chunk.load(std::memory_order_relaxed);
+                while (idx < failed && !failed_chunk.compare_exchange_weak(failed, idx, std::memory_order_relaxed))
+                {
+                }
+                return;
+            }
+            const std::size_t size = bounds[idx + 1] - bounds[idx];
+            const std::size_t done = done_bytes.fetch_add(size) + size;
+            if (report && progress)
+                progress(done);
+        }
+    };
+
+    {
+        std::vector<std::jthread> threads;
+        for (std::size_t i = 1; i < workers.size(); i++)
+            threads.emplace_back(work, std::ref(workers[i]), false);
+        work(workers[0], true);
+    }
+
+    for (const Worker &worker : workers)
+        stats.merge(worker.stats);
+    const std::size_t failed = failed_chunk.load();
+    for (std::size_t idx = 0; idx < chunk_count && idx <= failed; idx++)
+        counts.merge(results[idx].counts);
+    if (failed != SIZE_MAX)
+        std::rethrow_exception(results[failed].error);
+}
+
+void collect_interned_stats(const InternedTrace &trace, InstructionStats &stats, DecodeCounts &counts)
+{
+    const std::vector<uint64_t> occurrences = count_occurrences(trace);
+    for (uint32_t id = 0; id < trace.dictionary.size(); id++)
+    {
+        if (occurrences[id])
+            stats.add(trace.dictionary.instruction(id), occurrences[id]);
+    }
+    add_interned_counts(trace, occurrences, counts);
+}
+
+static void print_table(std::ostream &os, const char *title, std::span<const uint64_t> counts, uint64_t total,
+                        std::string_view (*name)(std::size_t))
+{
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < counts.size(); i++)
+        if (counts[i])
+            order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+                     { return counts[a] > counts[b]; });
+
+    os << "\n" << title << ":\n";
+    for (std::size_t i : order)
+    {
+        os << "  " << std::left << std::setw(18) << name(i) << std::right << std::setw(12) << counts[i] << std::fixed
+           << std::setprecision(2) << std::setw(8) << 100.0 * counts[i] / total << " %\n";
+    }
+    os << std::defaultfloat;
+}
+
+void print_instruction_stats(const InstructionStats &stats, std::ostream &os)
+{
+    const uint64_t total = stats.get_total();
+    os << "instructions: " << total << ", compressed: " << stats.compressed
+       << ", uncompressed: " << stats.uncompressed << "\n";
+    if (!total)
+        return;
+
+    print_table(os, "by mnemonic", stats.by_mnemonic, total, [](std::size_t i)
+                { return insts_mnem_map[i]; });
+    print_table(os, "by format", stats.by_format, total, [](std::size_t i)
+                { return InstructionFormatStringMap[i]; });
+    print_table(os, "by opcode class", stats.by_opcode_class, total, opcode_class_name);
+}
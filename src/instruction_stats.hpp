@@ -0,0 +1,105 @@
+#ifndef INSTRUCTION_STATS_HPP
+#define INSTRUCTION_STATS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string_view>
+
+#include "chunk_decoder.hpp"
+#include "instruction_dictionary.hpp"
+#include "instructions.hpp"
+
+// Cache line size of x86-64 and most AArch64 cores.
+// std::hardware_destructive_interference_size is not used because GCC warns
+// that its value may change between compiler versions.
+inline constexpr std::size_t cache_line_size = 64;
+
+// 32-bit words are classified by major opcode (bits 6:2), compressed ones
+// by quadrant.
+inline constexpr std::size_t opcode_class_count = 32 + 3;
+
+inline std::size_t opcode_class(uint32_t code)
+{
+    return (code & 0x3) == 0x3 ? (code >> 2) & 0x1f : 32 + (code & 0x3);
+}
+
+std::string_view opcode_class_name(std::size_t opcode_class);
+
+// Instruction mix histograms. Each thread fills its own copy; the alignment
+// keeps copies stored next to each other in a vector from sharing a cache
+// line.
+struct alignas(cache_line_size) InstructionStats
+{
+    std::array<uint64_t, INST_ENUM_COUNT> by_mnemonic{};
+    std::array<uint64_t, static_cast<std::size_t>(InstFormat::COUNT)> by_format{};
+    std::array<uint64_t, opcode_class_count> by_opcode_class{};
+    uint64_t compressed = 0;
+    uint64_t uncompressed = 0;
+
+    // n occurrences of inst
+    void add(const DecodedInstruction &inst, uint64_t n = 1)
+    {
+        by_mnemonic[inst.name] += n;
+        by_format[static_cast<std::size_t>(inst.format)] += n;
+        by_opcode_class[opcode_class(inst.code)] += n;
+        if (inst.compressed)
+            compressed += n;
+        else
+            uncompressed += n;
+    }
+
+    void merge(const InstructionStats &other);
+
+    uint64_t get_total() const { return compressed + uncompressed; }
+};
+
+// Counts decoded instructions in stats and counts; unknown encodings are
+// recorded, or with config.strict thrown with the line name(i) returns.
+template <typename Name>
+void add_stats_batch(std::span<const DecodedInstruction> insts, std::size_t unknown, const DecodeConfig &config,
+                     Name name, InstructionStats &stats, DecodeCounts &counts)
+{
+    const uint64_t compressed = stats.compressed;
+    for (std::size_t i = 0; i < insts.size(); i++)
+    {
+        if (unknown && !insts[i].is_known())
+        {
+            if (config.strict)
+            {
+                counts.count += i;
+                counts.count_compressed += stats.compressed - compressed;
+                fail_line(DecodeStatus::UNKNOWN_ENCODING, insts[i].code, name(i));
+            }
+            counts.unknown.record(insts[i].code);
+        }
+        stats.add(insts[i]);
+    }
+    counts.count += insts.size();
+    counts.count_compressed += stats.compressed - compressed;
+}
+
+// Decodes every line of a newline-aligned block into stats, in batches and
+// without rendering anything. Bad lines are handled as in decode_chunk.
+void collect_stats_chunk(std::string_view chunk, const DecodeConfig &config, InstructionStats &stats,
+                         DecodeCounts &counts);
+
+// Splits data into chunks and runs collect_stats_chunk on jobs threads, the
+// calling thread included. Every thread owns its histograms and every chunk
+// its DecodeCounts; they are only merged once all threads are done, the
+// counts in chunk order, so the threads never write to shared memory. With
+// config.strict the error of the first failing chunk is rethrown, after
+// every chunk before it has been decoded.
+void collect_stats(std::string_view data, const DecodeConfig &config, unsigned jobs, InstructionStats &stats,
+                   DecodeCounts &counts, const progress_callback_t &progress);
+
+// Stats of an interned trace: every distinct instruction is added once,
+// weighted by how often its ID occurs. Counts as write_interned_listing.
+void collect_interned_stats(const InternedTrace &trace, InstructionStats &stats, DecodeCounts &counts);
+
+// Tables by mnemonic, format and opcode class, most frequent first.
+void print_instruction_stats(const InstructionStats &stats, std::ostream &os);
+
+#endif
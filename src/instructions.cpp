@@ -1,150 +1,94 @@
 #include "instructions.hpp"
+#include "decoder.hpp"
 
-insts_map_t insts_mnem_map = insts_map_t({
-    {LOAD_PLACEHOLDER, "LOAD_PLACEHOLDER"},
-    {STORE_PLACEHOLDER, "STORE_PLACEHOLDER"},
-    {NOP, "NOP"},
-    {AUIPC, "AUIPC"},
-    {ADDI, "ADDI"},
-    {CSRRS, "CSRRS"},
-    {LD, "LD"},
-    {LB, "LB"},
-    {LH, "LH"},
-    {LW, "LW"},
-    {LBU, "LBU"},
-    {LHU, "LHU"},
-    {LWU, "LWU"},
-    {JALR, "JALR"},
-    {JAL, "JAL"},
-    {BEQ, "BEQ"},
-    {BNE, "BNE"},
-    {BLT, "BLT"},
-    {BGE, "BGE"},
-    {BLTU, "BLTU"},
-    {BGEU, "BGEU"},
-    {ADD, "ADD"},
-    {LUI, "LUI"},
-    {ADDIW, "ADDIW"},
-    {SLLIW, "SLLIW"},
-    {SLRIW_SAIW, "SLRIW_SAIW"},
-    {SD, "SD"},
-    {SUBW, "SUBW"},
-    {FMV, "FMV"},
-    {LR, "LR"},
-    {FENCE, "FENCE"},
-    {FMADD, "FMADD"},
-    {FNMSUB, "FNMSUB"},
+static_assert(all_named(insts_mnem_map), "every InstEnum needs a mnemonic in insts_mnem_map");
+static_assert(all_named(InstructionFormatStringMap), "every InstFormat needs a name in InstructionFormatStringMap");
+static_assert(all_named(RVC_reg_num_names_map), "every RVC register needs a name");
 
-    {C_ADDI4SPN, "C.ADDI4SPN"},
-    {C_FLD, "C.FLD"},
-    {C_LW, "C.LW"},
-    {C_FLW, "C.FLW"},
-    {C_LD, "C.LD"},
-    {C_FSD, "C.FSD"},
-    {C_SW, "C.SW"},
-    {C_FSW, "C.FSW"},
-    {C_SD, "C.SD"},
-    {C_ADDI, "C.ADDI"},
-    {C_JAL, "C.JAL"},
-    {C_JALR, "C.JALR"},
-    {C_ADDIW, "C.ADDIW"},
-    {C_LI, "C.LI"},
-    {C_LUI, "C.LUI"},
-    {C_ADDI16SP, "C.ADDI16SP"},
-    {C_MISC_ALU_ADDW, "C.MISC_ALU_ADDW"},
-    {C_MISC_ALU_, "C.MISC_ALU_"},
-    {C_J, "C.J"},
-    {C_BEQZ, "C.BEQZ"},
-    {C_BNEZ, "C.BNEZ"},
-    {C_SLLI, "C.SLLI"},
-    {C_FLDSP, "C.FLDSP"},
-    {C_LWSP, "C.LWSP"},
-    {C_FLWSP, "C.FLWSP"},
-    {C_LDSP, "C.LDSP"},
-    {C_MV, "C.MV"},
-    {C_JR, "C.JR"},
-    {C_ADD, "C.ADD"},
-    {C_FSDSP, "C.FSDSP"},
-    {C_SWSP, "C.SWSP"},
-    {C_FSWSP, "C.FSWSP"},
-    {C_SDSP, "C.SDSP"},
-    {C_EBREAK, "C.EBREAK"},
-    {C_NOP, "C.NOP"},
-    {C_SUB, "C.SUB"},
-    {C_XOR, "C.XOR"},
-    {C_OR, "C.OR"},
-    {C_AND, "C.AND"},
-    {C_SRLI, "C.SRLI"},
-    {C_SRAI, "C.SRAI"},
-    {C_ANDI, "C.ANDI"},
-
-    {V_VSETVLI, "V_VSETVLI"},
-    {V_VSETVL, "V_VSETVL"},
-    {V_VSETIVLI, "V_VSETIVLI"},
-    {V_ADD, "V_ADD"},
-    {V_SUB, "V_SUB"},
-    {V_MERGE, "V_MERGE"},
-    {V_SMUL, "V_SMUL"},
-    {V_SLL, "V_SLL"},
-    {V_SLIDEDOWN, "V_SLIDEDOWN"},
-    {V_RSUB, "V_RSUB"},
-    {V_RGATHER, "V_RGATHER"},
-    {V_MACC, "V_MACC"},
-    {V_MV_S_X, "V_MV_S_X"},
-    {V_MV_X_S, "V_MV_X_S"},
-    {V_POPC, "V_POPC"},
-    {V_FIRST, "V_FIRST"},
-    {V_FADD, "V_FADD"},
-    {V_FMV, "V_FMV"},
-    {V_ID_V, "V_ID_V"},
-    {V_MSBF, "V_MSBF"},
-    {V_MSOF, "V_MSOF"},
-    {V_MSIF, "V_MSIF"},
-    {V_IOTA, "V_IOTA"},
-    {V_ID_V, "V_ID_V"},
-    {V_FMUL, "V_FMUL"},
-    {V_FMV_F_S, "V_FMV_F_S"},
-    {V_FMV_S_F, "V_FMV_S_F"},
-    {V_MFNE, "V_MFNE"},
-    {V_REDSUM, "V_REDSUM"},
-    {V_FREDOSUM, "V_FREDOSUM"},
-    {V_FREDUSUM, "V_FREDUSUM"},
-    {V_FMACC, "V_FMACC"},
-    {V_FNMSAC, "V_FNMSAC"},
-    {V_FNMSUB, "V_FNMSUB"},
-});
-
-if_string_map_t InstructionFormatStringMap = if_string_map_t({{InstFormat::R, "R"},
-                                                              {InstFormat::I, "I"},
-                                                              {InstFormat::S, "S"},
-                                                              {InstFormat::B, "B"},
-                                                              {InstFormat::U, "U"},
-                                                              {InstFormat::J, "J"},
-                                                              {InstFormat::CR, "CR"},
-                                                              {InstFormat::CI, "CI"},
-                                                              {InstFormat::CSS, "CSS"},
-                                                              {InstFormat::CIW, "CIW"},
-                                                              {InstFormat::CL, "CL"},
-                                                              {InstFormat::CS, "CS"},
-                                                              {InstFormat::CB, "CB"},
-                                                              {InstFormat::CJ, "CJ"},
-                                                              {InstFormat::OPIVV, "OPIVV"},
-                                                              {InstFormat::OPFVV, "OPFVV"},
-                                                              {InstFormat::OPMVV, "OPMVV"},
-                                                              {InstFormat::OPIVI, "OPIVI"},
-                                                              {InstFormat::OPIVX, "OPIVX"},
-                                                              {InstFormat::OPFVF, "OPFVF"},
-                                                              {InstFormat::OPMVX, "OPMVX"},
-                                                              {InstFormat::OPCFG, "OPCFG"},
-                                                              {InstFormat::UNKNOWN, "UNKNOWN"}});
-
-RVC_reg_num_names_map_t RVC_reg_num_names_map = RVC_reg_num_names_map_t({
-    {RVC_reg_num::x8, "x8"},
-    {RVC_reg_num::x9, "x9"},
-    {RVC_reg_num::x10, "x10"},
-    {RVC_reg_num::x11, "x11"},
-    {RVC_reg_num::x12, "x12"},
-    {RVC_reg_num::x13, "x13"},
-    {RVC_reg_num::x14, "x14"},
-    {RVC_reg_num::x15, "x15"},
-});
\ No newline at end of file
+void DecodedInstruction::print_payload(OutputBuffer &out) const
+{
+    switch (format)
+    {
+    case InstFormat::R:
+        out << " x" << +rd
+            << ", x" << +rs1
+            << ", x" << +rs2;
+        break;
+    case InstFormat::R_4:
+        out << "rs3: " << +rs3
+            << ", rs2: " << +rs2
+            << ", rs1: " << +rs1
+            << ", rm: " << +rd;
+        break;
+    case InstFormat::I:
+        out << " x" << +rd
+            << ", " << imm
+            << "(" << +rs1 << ")";
+        break;
+    case InstFormat::S:
+        out << "imm_upper: " << MASK(code, bitmask_31_25)
+            << ", rs2: " << +rs2
+            << ", rs1: " << +rs1
+            << ", imm_lower: " << MASK(code, bitmask_11_7);
+        break;
+    case InstFormat::B:
+        out << " x" << +rs2
+            << ", x" << +rs1
+            << ", " << imm;
+        break;
+    case InstFormat::U:
+    case InstFormat::J:
+        out << " x" << +rd
+            << ", " << imm;
+        break;
+    case InstFormat::OPIVV:
+        out << "vs2: " << +rs2 << " vs1: " << +rs1 << " vd: " << +rd;
+        break;
+    case InstFormat::OPFVV:
+    case InstFormat::OPMVV:
+        out << "vs2: " << +rs2 << " vs1: " << +rs1 << " vd/rd: " << +rd;
+        break;
+    case InstFormat::OPIVI:
+        out << "vs2: " << +rs2 << " imm: " << +rs1 << " vd: " << +rd;
+        break;
+    case InstFormat::OPIVX:
+    case InstFormat::OPFVF:
+        out << "vs2: " << +rs2 << " rs1: " << +rs1 << " vd: " << +rd;
+        break;
+    case InstFormat::OPMVX:
+        out << "vs2: " << +rs2 << " rs1: " << +rs1 << " vd/rd: " << +rd;
+        break;
+    case InstFormat::CR:
+        out << "x" << +rd << ", x" << +rs2;
+        break;
+    case InstFormat::CI:
+        out << " x" << +rd << ", " << imm;
+        break;
+    case InstFormat::CSS:
+        out << " x" << +rs2 << ", " << imm;
+        break;
+    case InstFormat::CIW:
+        out << "imm: " << imm << ", " << get_rvc_reg_name(rd);
+        break;
+    case InstFormat::CL:
+        out << "imm_upper: " << MASK(code, bitmask_12_10) << ", " << get_rvc_reg_name(rs1)
+            << " imm_lower: " << MASK(code, bitmask_6_5) << ", " << get_rvc_reg_name(rd);
+        break;
+    case InstFormat::CS:
+        out << "imm_upper: " << MASK(code, bitmask_12_10) << ", " << get_rvc_reg_name(rs1)
+            << " imm_lower: " << MASK(code, bitmask_6_5) << ", " << get_rvc_reg_name(rs2);
+        break;
+    case InstFormat::CA:
+        out << get_rvc_reg_name(rd) << ", " << get_rvc_reg_name(rs2);
+        break;
+    case InstFormat::CB:
+        out << get_rvc_reg_name(rd) << ", " << imm;
+        break;
+    case InstFormat::CJ:
+        out << "imm: " << uint32_t_to_dec_hex_bin(MASK(code, bitmask_12_2)) << " offset: " << imm;
+        break;
+    default:
+        // OPCFG and UNKNOWN carry no operands
+        break;
+    }
+}
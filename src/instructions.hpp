@@ -8,12 +8,13 @@
 #include <utility>
 #include <tuple>
 #include <vector>
-#include <unordered_map>
 #include <memory>
-#include <variant>
+#include <type_traits>
 #include <iostream>
 
 #include "utils.hpp"
+#include "output.hpp"
+#include "bit_scatter.hpp"
 
 enum InstType
 {
@@ -27,7 +28,7 @@ enum InstType
     C
 };
 
-enum class InstFormat
+enum class InstFormat : uint8_t
 {
     UNKNOWN,
     R,
@@ -53,11 +54,13 @@ enum class InstFormat
     OPIVX,
     OPFVF,
     OPMVX,
-    OPCFG
+    OPCFG,
+    COUNT
 };
 
-enum InstEnum
+enum InstEnum : uint8_t
 {
+    UNKNOWN,
     LOAD_PLACEHOLDER,
     STORE_PLACEHOLDER,
     // common
@@ -177,11 +180,68 @@ enum InstEnum
     V_FREDUSUM,
     V_FMACC,
     V_FNMSAC,
-    V_FNMSUB
+    V_FNMSUB,
+
+    INST_ENUM_COUNT
 };
 
-using if_string_map_t = std::unordered_map<InstFormat, std::string_view>;
-extern if_string_map_t InstructionFormatStringMap;
+// Builds a name table indexed by enumerator. Naming an enumerator twice
+// is not a constant expression, so duplicates fail to compile.
+template <typename Enum, std::size_t N, std::size_t M>
+constexpr std::array<std::string_view, N> make_name_table(const std::pair<Enum, std::string_view> (&names)[M])
+{
+    std::array<std::string_view, N> table{};
+    for (const auto &[value, name] : names)
+    {
+        if (!table[static_cast<std::size_t>(value)].empty())
+            throw "enumerator named twice";
+        table[static_cast<std::size_t>(value)] = name;
+    }
+    return table;
+}
+
+template <std::size_t N>
+constexpr bool all_named(const std::array<std::string_view, N> &table)
+{
+    for (const auto &name : table)
+        if (name.empty())
+            return false;
+    return true;
+}
+
+inline constexpr std::array<std::string_view, static_cast<std::size_t>(InstFormat::COUNT)> InstructionFormatStringMap =
+    make_name_table<InstFormat, static_cast<std::size_t>(InstFormat::COUNT)>({
+        {InstFormat::UNKNOWN, "UNKNOWN"},
+        {InstFormat::R, "R"},
+        {InstFormat::R_4, "R_4"},
+        {InstFormat::I, "I"},
+        {InstFormat::S, "S"},
+        {InstFormat::B, "B"},
+        {InstFormat::U, "U"},
+        {InstFormat::J, "J"},
+        {InstFormat::CR, "CR"},
+        {InstFormat::CI, "CI"},
+        {InstFormat::CSS, "CSS"},
+        {InstFormat::CIW, "CIW"},
+        {InstFormat::CL, "CL"},
+        {InstFormat::CS, "CS"},
+        {InstFormat::CA, "CA"},
+        {InstFormat::CB, "CB"},
+        {InstFormat::CJ, "CJ"},
+        {InstFormat::OPIVV, "OPIVV"},
+        {InstFormat::OPFVV, "OPFVV"},
+        {InstFormat::OPMVV, "OPMVV"},
+        {InstFormat::OPIVI, "OPIVI"},
+        {InstFormat::OPIVX, "OPIVX"},
+        {InstFormat::OPFVF, "OPFVF"},
+        {InstFormat::OPMVX, "OPMVX"},
+        {InstFormat::OPCFG, "OPCFG"},
+    });
+
+inline std::string_view inst_format_name(InstFormat format)
+{
+    return InstructionFormatStringMap[static_cast<std::size_t>(format)];
+}
 
 enum RVC_reg_num
 {
@@ -231,400 +291,179 @@ enum RVC_fp_reg_abi_name
     fa5,
 };
 
-using RVC_reg_num_names_map_t = std::unordered_map<RVC_reg_num, std::string_view>;
-extern RVC_reg_num_names_map_t RVC_reg_num_names_map;
+inline constexpr std::array<std::string_view, 8> RVC_reg_num_names_map =
+    make_name_table<RVC_reg_num, 8>({
+        {RVC_reg_num::x8, "x8"},
+        {RVC_reg_num::x9, "x9"},
+        {RVC_reg_num::x10, "x10"},
+        {RVC_reg_num::x11, "x11"},
+        {RVC_reg_num::x12, "x12"},
+        {RVC_reg_num::x13, "x13"},
+        {RVC_reg_num::x14, "x14"},
+        {RVC_reg_num::x15, "x15"},
+    });
 
-static std::string_view get_rvc_reg_name(uint8_t reg_num)
+// reg_num is always a 3-bit field
+inline std::string_view get_rvc_reg_name(uint8_t reg_num)
 {
-    return RVC_reg_num_names_map[static_cast<RVC_reg_num>(reg_num)];
+    return RVC_reg_num_names_map[reg_num & 0x7];
 }
 
-struct TypeFields
-{
-    virtual void print_operands() const = 0;
-};
-
-struct OPIVVTypeFields : TypeFields
-{
-    uint8_t vs2;
-    uint8_t vs1;
-    uint8_t vd;
-
-    OPIVVTypeFields(uint8_t vs2, uint8_t vs1, uint8_t vd) : vs2(vs2), vs1(vs1), vd(vd) {}
-
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " vs1: " << +vs1 << " vd: " << +vd;
-    }
-};
-
-struct OPFVVTypeFields : TypeFields
-{
-    uint8_t vs2, vs1, vd_rd;
-    OPFVVTypeFields(uint8_t vs2, uint8_t vs1, uint8_t vd_rd)
-        : vs2(vs2), vs1(vs1), vd_rd(vd_rd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " vs1: " << +vs1 << " vd/rd: " << +vd_rd;
-    }
-};
-
-struct OPMVVTypeFields : TypeFields
-{
-    uint8_t vs2, vs1, vd_rd;
-    OPMVVTypeFields(uint8_t vs2, uint8_t vs1, uint8_t vd_rd)
-        : vs2(vs2), vs1(vs1), vd_rd(vd_rd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " vs1: " << +vs1 << " vd/rd: " << +vd_rd;
-    }
-};
-
-struct OPIVITypeFields : TypeFields
-{
-    uint8_t vs2, imm, vd;
-    OPIVITypeFields(uint8_t vs2, uint8_t imm, uint8_t vd)
-        : vs2(vs2), imm(imm), vd(vd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " imm: " << +imm << " vd: " << +vd;
-    }
-};
-
-struct OPIVXTypeFields : TypeFields
-{
-    uint8_t vs2, rs1, vd;
-    OPIVXTypeFields(uint8_t vs2, uint8_t rs1, uint8_t vd)
-        : vs2(vs2), rs1(rs1), vd(vd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " rs1: " << +rs1 << " vd: " << +vd;
-    }
-};
-
-struct OPFVFTypeFields : TypeFields
-{
-    uint8_t vs2, rs1, vd;
-    OPFVFTypeFields(uint8_t vs2, uint8_t rs1, uint8_t vd)
-        : vs2(vs2), rs1(rs1), vd(vd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " rs1: " << +rs1 << " vd: " << +vd;
-    }
-};
-
-struct OPMVXTypeFields : TypeFields
-{
-    uint8_t vs2, rs1, vd_rd;
-    OPMVXTypeFields(uint8_t vs2, uint8_t rs1, uint8_t vd_rd)
-        : vs2(vs2), rs1(rs1), vd_rd(vd_rd) {}
-    void print_operands() const override
-    {
-        std::cout << "vs2: " << +vs2 << " rs1: " << +rs1 << " vd/rd: " << +vd_rd;
-    }
-};
-
-struct CRTypeFields : TypeFields
-{
-    uint8_t rd_rs1, rs2;
-    CRTypeFields(uint8_t rd_rs1, uint8_t rs2)
-        : rd_rs1(rd_rs1), rs2(rs2) {}
-    void print_operands() const override
-    {
-        std::cout << "x" << +rd_rs1 << ", x" << +rs2;
-    }
-};
-
-struct CITypeFields : TypeFields
-{
-    uint8_t imm_upper, rd_rs1, imm_lower;
-    int16_t immediate;
-
-    CITypeFields(uint8_t imm_upper, uint8_t rd_rs1, uint8_t imm_lower)
-        : imm_upper(imm_upper), rd_rs1(rd_rs1), imm_lower(imm_lower), immediate(0) {}
-
-    CITypeFields(uint8_t imm_upper, uint8_t rd_rs1, uint8_t imm_lower, int16_t imm)
-        : imm_upper(imm_upper), rd_rs1(rd_rs1), imm_lower(imm_lower), immediate(imm) {}
-
-    void print_operands() const override
-    {
-        std::cout << " x" << +rd_rs1 << ", " << immediate;
-    }
-};
-
-struct CSSTypeFields : TypeFields
-{
-    uint8_t imm, rs2;
-    int32_t immediate;
-
-    CSSTypeFields(uint8_t imm, uint8_t rs2, int32_t immediate)
-        : imm(imm), rs2(rs2), immediate(immediate) {}
-    void print_operands() const override
-    {
-        std::cout << " x" << +rs2 << ", " << immediate;
-    }
-};
-
-struct CIWTypeFields : TypeFields
-{
-    uint8_t imm, rd;
-    CIWTypeFields(uint8_t imm, uint8_t rd)
-        : imm(imm), rd(rd) {}
-    void print_operands() const override
-    {
-        std::cout << "imm: " << +imm << ", " << get_rvc_reg_name(rd);
-    }
-};
-
-struct CLTypeFields : TypeFields
-{
-    uint8_t imm_upper, rs1, imm_lower, rd;
-    CLTypeFields(uint8_t imm_upper, uint8_t rs1, uint8_t imm_lower, uint8_t rd)
-        : imm_upper(imm_upper), rs1(rs1), imm_lower(imm_lower), rd(rd) {}
-    void print_operands() const override
-    {
-        std::cout << "imm_upper: " << +imm_upper << ", " << get_rvc_reg_name(rs1) << " imm_lower: " << +imm_lower << ", " << get_rvc_reg_name(rd);
-    }
-};
-
-struct CSTypeFields : TypeFields
-{
-    uint8_t imm_upper, rs1, imm_lower, rs2;
-    CSTypeFields(uint8_t imm_upper, uint8_t rs1, uint8_t imm_lower, uint8_t rs2)
-        : imm_upper(imm_upper), rs1(rs1), imm_lower(imm_lower), rs2(rs2) {}
-    void print_operands() const override
-    {
-        std::cout << "imm_upper: " << +imm_upper << ", " << get_rvc_reg_name(rs1) << " imm_lower: " << +imm_lower << ", " << get_rvc_reg_name(rs2);
-    }
-};
-
-struct CATypeFields : TypeFields
-{
-    uint8_t rd_rs1, rs2;
-    CATypeFields(uint8_t rd_rs1, uint8_t rs2)
-        : rd_rs1(rd_rs1), rs2(rs2) {}
-    void print_operands() const override
-    {
-        std::cout << get_rvc_reg_name(rd_rs1) << ", " << get_rvc_reg_name(rs2);
-    }
-};
-
-struct CBTypeFields : TypeFields
-{
-    uint8_t offset_upper, rd_rs1, offset_lower;
-    int8_t offset;
-
-    CBTypeFields(uint8_t offset_upper, uint8_t rd_rs1, uint8_t offset_lower)
-        : offset_upper(offset_upper), rd_rs1(rd_rs1), offset_lower(offset_lower), offset(0) {}
-
-    CBTypeFields(uint8_t offset_upper, uint8_t rd_rs1, uint8_t offset_lower, int8_t offset)
-        : offset_upper(offset_upper), rd_rs1(rd_rs1), offset_lower(offset_lower), offset(offset) {}
-
-    void print_operands() const override
-    {
-        std::cout << get_rvc_reg_name(rd_rs1) << ", " << +offset;
-    }
-};
-
-struct CJTypeFields : TypeFields
-{
-    uint16_t imm;
-    int32_t offset;
-    CJTypeFields(uint16_t imm)
-        : imm(imm)
-    {
-    }
-
-    CJTypeFields(uint16_t imm, int32_t offset)
-        : imm(imm), offset(offset)
-    {
-    }
-
-    void print_operands() const override
-    {
-        std::cout << "imm: " << uint32_t_to_dec_hex_bin(imm) << " offset: " << offset;
-    }
-};
-
-struct RTypeFields : TypeFields
-{
-    uint8_t funct7;
-    uint8_t rs2;
-    uint8_t rs1;
-    uint8_t rd;
-    RTypeFields(uint8_t funct7, uint8_t rs2, uint8_t rs1, uint8_t rd)
-        : funct7(funct7), rs2(rs2), rs1(rs1), rd(rd) {}
-    void print_operands() const override
-    {
-        std::cout << " x" << +rd
-                  << ", x" << +rs1
-                  << ", x" << +rs2;
-    }
-};
-
-struct R_4TypeFields : TypeFields
-{
-    uint8_t rs3;
-    uint8_t rs2;
-    uint8_t rs1;
-    uint8_t rm;
-    R_4TypeFields(uint8_t rs3, uint8_t rs2, uint8_t rs1, uint8_t rm)
-        : rs3(rs3), rs2(rs2), rs1(rs1), rm(rm) {}
-    void print_operands() const override
-    {
-        std::cout << "rs3: " << +rs3
-                  << ", rs2: " << +rs2
-                  << ", rs1: " << +rs1
-                  << ", rm: " << +rm;
-    }
-};
-
-struct ITypeFields : TypeFields
+inline constexpr std::array<std::string_view, INST_ENUM_COUNT> insts_mnem_map =
+    make_name_table<InstEnum, INST_ENUM_COUNT>({
+        {UNKNOWN, "UNKNOWN"},
+        {LOAD_PLACEHOLDER, "LOAD_PLACEHOLDER"},
+        {STORE_PLACEHOLDER, "STORE_PLACEHOLDER"},
+        {NOP, "NOP"},
+        {AUIPC, "AUIPC"},
+        {ADDI, "ADDI"},
+        {CSRRS, "CSRRS"},
+        {LD, "LD"},
+        {LB, "LB"},
+        {LH, "LH"},
+        {LW, "LW"},
+        {LBU, "LBU"},
+        {LHU, "LHU"},
+        {LWU, "LWU"},
+        {JALR, "JALR"},
+        {JAL, "JAL"},
+        {BEQ, "BEQ"},
+        {BNE, "BNE"},
+        {BLT, "BLT"},
+        {BGE, "BGE"},
+        {BLTU, "BLTU"},
+        {BGEU, "BGEU"},
+        {ADD, "ADD"},
+        {LUI, "LUI"},
+        {ADDIW, "ADDIW"},
+        {SLLIW, "SLLIW"},
+        {SLRIW_SAIW, "SLRIW_SAIW"},
+        {SD, "SD"},
+        {SUBW, "SUBW"},
+        {FMV, "FMV"},
+        {LR, "LR"},
+        {FENCE, "FENCE"},
+        {FMADD, "FMADD"},
+        {FNMSUB, "FNMSUB"},
+        {C_ADDI4SPN, "C.ADDI4SPN"},
+        {C_FLD, "C.FLD"},
+        {C_LW, "C.LW"},
+        {C_FLW, "C.FLW"},
+        {C_LD, "C.LD"},
+        {C_FSD, "C.FSD"},
+        {C_SW, "C.SW"},
+        {C_FSW, "C.FSW"},
+        {C_SD, "C.SD"},
+        {C_ADDI, "C.ADDI"},
+        {C_JAL, "C.JAL"},
+        {C_JALR, "C.JALR"},
+        {C_ADDIW, "C.ADDIW"},
+        {C_LI, "C.LI"},
+        {C_LUI, "C.LUI"},
+        {C_ADDI16SP, "C.ADDI16SP"},
+        {C_MISC_ALU_ADDW, "C.MISC_ALU_ADDW"},
+        {C_MISC_ALU_, "C.MISC_ALU_"},
+        {C_J, "C.J"},
+        {C_BEQZ, "C.BEQZ"},
+        {C_BNEZ, "C.BNEZ"},
+        {C_SLLI, "C.SLLI"},
+        {C_FLDSP, "C.FLDSP"},
+        {C_LWSP, "C.LWSP"},
+        {C_FLWSP, "C.FLWSP"},
+        {C_LDSP, "C.LDSP"},
+        {C_MV, "C.MV"},
+        {C_JR, "C.JR"},
+        {C_ADD, "C.ADD"},
+        {C_FSDSP, "C.FSDSP"},
+        {C_SWSP, "C.SWSP"},
+        {C_FSWSP, "C.FSWSP"},
+        {C_SDSP, "C.SDSP"},
+        {C_EBREAK, "C.EBREAK"},
+        {C_NOP, "C.NOP"},
+        {C_SUB, "C.SUB"},
+        {C_XOR, "C.XOR"},
+        {C_OR, "C.OR"},
+        {C_AND, "C.AND"},
+        {C_SRLI, "C.SRLI"},
+        {C_SRAI, "C.SRAI"},
+        {C_ANDI, "C.ANDI"},
+        {V_VSETVLI, "V_VSETVLI"},
+        {V_VSETVL, "V_VSETVL"},
+        {V_VSETIVLI, "V_VSETIVLI"},
+        {V_ADD, "V_ADD"},
+        {V_SUB, "V_SUB"},
+        {V_MERGE, "V_MERGE"},
+        {V_SMUL, "V_SMUL"},
+        {V_SLL, "V_SLL"},
+        {V_SLIDEDOWN, "V_SLIDEDOWN"},
+        {V_RSUB, "V_RSUB"},
+        {V_RGATHER, "V_RGATHER"},
+        {V_MACC, "V_MACC"},
+        {V_MV_S_X, "V_MV_S_X"},
+        {V_MV_X_S, "V_MV_X_S"},
+        {V_POPC, "V_POPC"},
+        {V_FIRST, "V_FIRST"},
+        {V_FADD, "V_FADD"},
+        {V_FMV, "V_FMV"},
+        {V_ID_V, "V_ID_V"},
+        {V_MSBF, "V_MSBF"},
+        {V_MSOF, "V_MSOF"},
+        {V_MSIF, "V_MSIF"},
+        {V_IOTA, "V_IOTA"},
+        {V_FMUL, "V_FMUL"},
+        {V_FMV_F_S, "V_FMV_F_S"},
+        {V_FMV_S_F, "V_FMV_S_F"},
+        {V_MFNE, "V_MFNE"},
+        {V_REDSUM, "V_REDSUM"},
+        {V_FREDOSUM, "V_FREDOSUM"},
+        {V_FREDUSUM, "V_FREDUSUM"},
+        {V_FMACC, "V_FMACC"},
+        {V_FNMSAC, "V_FNMSAC"},
+        {V_FNMSUB, "V_FNMSUB"},
+    });
+
+// Trivially copyable 16-byte record of one decoded instruction. Operand
+// fields a format does not use stay zero; imm holds the sign-extended
+// immediate (the raw unsigned field for I and U formats). The trace line an
+// instruction came from is not stored, callers that need it keep its byte
+// offset in the input alongside.
+struct DecodedInstruction
 {
-    uint16_t imm;
-    uint8_t rs1;
+    uint32_t code;
+    int32_t imm;
+    InstEnum name;
+    InstFormat format;
     uint8_t rd;
-    ITypeFields(uint16_t imm, uint8_t rs1, uint8_t rd)
-        : imm(imm), rs1(rs1), rd(rd) {}
-    void print_operands() const override
-    {
-        std::cout << " x" << +rd
-                  << ", " << +imm
-                  << "(" << +rs1 << ")";
-    }
-};
-
-struct STypeFields : TypeFields
-{
-    uint8_t imm_upper;
-    uint8_t rs2;
     uint8_t rs1;
-    uint8_t imm_lower;
-    STypeFields(uint8_t imm_upper, uint8_t rs2, uint8_t rs1, uint8_t imm_lower)
-        : imm_upper(imm_upper), rs2(rs2), rs1(rs1), imm_lower(imm_lower) {}
-    void print_operands() const override
-    {
-        std::cout << "imm_upper: " << +imm_upper
-                  << ", rs2: " << +rs2
-                  << ", rs1: " << +rs1
-                  << ", imm_lower: " << +imm_lower;
-    }
-};
-
-struct BTypeFields : TypeFields
-{
-    uint8_t imm_upper;
     uint8_t rs2;
-    uint8_t rs1;
-    uint8_t imm_lower;
-    uint8_t bit_7;
-
-    int16_t immediate;
-
-    BTypeFields(uint8_t imm_upper, uint8_t rs2, uint8_t rs1,
-                uint8_t imm_lower, uint8_t bit_7)
-        : imm_upper(imm_upper), rs2(rs2), rs1(rs1), imm_lower(imm_lower), bit_7(bit_7) {}
-
-    BTypeFields(uint8_t imm_upper, uint8_t rs2, uint8_t rs1,
-                uint8_t imm_lower, uint8_t bit_7, int16_t imm)
-        : imm_upper(imm_upper), rs2(rs2), rs1(rs1), imm_lower(imm_lower), bit_7(bit_7), immediate(imm) {}
-    void print_operands() const override
-    {
-        std::cout << " x" << +rs2
-                  << ", x" << +rs1
-                  << ", " << immediate;
-    }
-};
+    uint8_t rs3;
+    bool compressed;
 
-struct UTypeFields : TypeFields
-{
-    uint32_t imm;
-    uint8_t rd;
-    UTypeFields(uint32_t imm, uint8_t rd)
-        : imm(imm), rd(rd) {}
-    void print_operands() const override
+    std::string_view mnemonic() const
     {
-        std::cout << " x" << +rd
-                  << ", " << +imm;
+        return insts_mnem_map[name];
     }
-};
 
-struct JTypeFields : TypeFields
-{
-    uint16_t imm_upper;
-    uint8_t bit_20;
-    uint8_t imm_lower;
-    uint8_t rd;
-    int32_t immediate;
-    JTypeFields(uint16_t imm_upper, uint8_t bit_20, uint8_t imm_lower, uint8_t rd, int32_t imm)
-        : imm_upper(imm_upper), bit_20(bit_20), imm_lower(imm_lower), rd(rd), immediate(imm) {}
-    void print_operands() const override
+    // false for words the decoder found no instruction for, including those
+    // whose format is known and whose operands are listed
+    bool is_known() const
     {
-        std::cout << " x" << +rd
-                  << ", " << immediate;
+        return name != UNKNOWN;
     }
-};
-
-using FormatPayload = std::variant<
-    std::monostate,
-
-    RTypeFields,
-    R_4TypeFields,
-    ITypeFields,
-    STypeFields,
-    BTypeFields,
-    UTypeFields,
-    JTypeFields,
-
-    // RTypeFields,
-    OPIVVTypeFields,
-    OPFVVTypeFields,
-    OPMVVTypeFields,
-    OPIVITypeFields,
-    OPIVXTypeFields,
-    OPFVFTypeFields,
-    OPMVXTypeFields,
-    CRTypeFields,
-    CITypeFields,
-    CSSTypeFields,
-    CIWTypeFields,
-    CLTypeFields,
-    CSTypeFields,
-    CATypeFields,
-    CBTypeFields,
-    CJTypeFields>;
 
-struct DecodedInstruction
-{
-    uint32_t code;
-    std::string_view mnemonic;
-    std::string line;
-    InstEnum name;
-    InstFormat format;
-    FormatPayload payload;
-
-    bool compressed;
-
-    void print()
+    void print() const
     {
-        std::cout << "[Instruction print]" << std::endl;
-        std::cout << line << std::endl;
-        std::cout << "format: " << InstructionFormatStringMap[format] << std::endl;
+        std::cerr << "[Instruction print]" << std::endl;
+        std::cerr << "code: " << uint32_t_to_hex(code) << std::endl;
+        std::cerr << "format: " << inst_format_name(format) << std::endl;
     };
 
-    void print_payload() const
-    {
-        std::visit([](const auto &payload)
-                   {
-        if constexpr (!std::is_same_v<std::decay_t<decltype(payload)>, std::monostate>)
-        {
-            payload.print_operands();
-        } }, payload);
-    }
+    void print_payload(OutputBuffer &out) const;
 };
 
-using insts_map_t = std::unordered_map<InstEnum, std::string_view>;
-extern insts_map_t insts_mnem_map;
+static_assert(sizeof(DecodedInstruction) <= 16, "DecodedInstruction should stay compact");
+static_assert(std::is_trivially_copyable_v<DecodedInstruction>, "DecodedInstruction must be memcpy-able");
+
 using inst_u_ptr = std::unique_ptr<DecodedInstruction>;
 
 #include <bitset>
@@ -694,13 +533,7 @@ static constexpr std::array<std::pair<int, int>, 6> addi16sp_imm_bit_map = {{
     {5, 0},
 }};
 
-template <typename OFFSET_B_M_T>
-uint32_t extract_offset(uint32_t offset_raw, OFFSET_B_M_T bitmap)
-{
-    uint32_t offset = 0;
-    for (const auto &[to, from] : bitmap)
-        offset |= ((offset_raw >> from) & 0x1) << to;
-    return offset;
-}
+static_assert(scatter_bits_slow<j_imm_bit_map>(0xfffff) == 0x1ffffe, "j_imm_bit_map must cover imm[20:1]");
+static_assert(scatter_bits_slow<b_offset_bit_map>(0xfff) == 0x1ffe, "b_offset_bit_map must cover imm[12:1]");
 
 #endif
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include <cctype>
+#include <stdexcept>
+#include <utility>
+
+#include "isa.hpp"
+
+static uint32_t single_letter_extension(char letter)
+{
+    switch (letter)
+    {
+    case 'i':
+        return ISA_I;
+    case 'g':
+        return ISA_G;
+    case 'm':
+        return ISA_M;
+    case 'a':
+        return ISA_A;
+    case 'f':
+        return ISA_F;
+    case 'd':
+        return ISA_D;
+    case 'c':
+        return ISA_C;
+    case 'v':
+        return ISA_V;
+    default:
+        return 0;
+    }
+}
+
+static uint32_t multi_letter_extension(std::string_view name)
+{
+    if (name == "zicsr")
+        return ISA_ZICSR;
+    if (name == "zicntr")
+        return ISA_ZICNTR;
+    if (name == "zifencei")
+        return ISA_ZIFENCEI;
+    return 0;
+}
+
+uint32_t parse_isa(std::string_view isa)
+{
+    std::string lower;
+    for (char c : isa)
+        lower += std::tolower(static_cast<unsigned char>(c));
+    std::string_view rest = lower;
+
+    if (rest.starts_with("rv32"))
+        throw std::runtime_error("Only RV64 traces are supported: " + std::string(isa));
+    if (!rest.starts_with("rv64"))
+        throw std::runtime_error("Invalid ISA string: " + std::string(isa));
+    rest.remove_prefix(4);
+
+    if (rest.empty() || (rest[0] != 'i' && rest[0] != 'g'))
+        throw std::runtime_error("ISA string must start with rv64i or rv64g: " + std::string(isa));
+
+    uint32_t result = 0;
+    // single-letter extensions up to the first underscore
+    while (!rest.empty() && rest[0] != '_')
+    {
+        if (!std::isalpha(static_cast<unsigned char>(rest[0])))
+            throw std::runtime_error("Invalid ISA string: " + std::string(isa));
+        result |= single_letter_extension(rest[0]);
+        rest.remove_prefix(1);
+    }
+
+    // then underscore separated multi-letter extensions
+    while (!rest.empty())
+    {
+        rest.remove_prefix(1);
+        std::size_t end = rest.find('_');
+        std::string_view name = rest.substr(0, end);
+        if (name.empty())
+            throw std::runtime_error("Invalid ISA string: " + std::string(isa));
+        result |= multi_letter_extension(name);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size() : end);
+    }
+
+    return result;
+}
+
+uint32_t parse_extension(std::string_view name)
+{
+    std::string lower;
+    for (char c : name)
+        lower += std::tolower(static_cast<unsigned char>(c));
+
+    const uint32_t ext = lower.size() == 1 ? single_letter_extension(lower[0]) : multi_letter_extension(lower);
+    if (!ext)
+        throw std::runtime_error("Unknown extension: " + std::string(name));
+    return ext;
+}
+
+std::string isa_to_string(uint32_t isa)
+{
+    std::string result = "rv64";
+    if ((isa & ISA_G) == ISA_G)
+    {
+        result += 'g';
+        isa &= ~ISA_G;
+    }
+
+    static constexpr std::pair<uint32_t, char> letters[] = {
+        {ISA_I, 'i'}, {ISA_M, 'm'}, {ISA_A, 'a'}, {ISA_F, 'f'}, {ISA_D, 'd'}, {ISA_C, 'c'}, {ISA_V, 'v'}};
+    for (auto [ext, letter] : letters)
+        if (isa & ext)
+            result += letter;
+
+    static constexpr std::pair<uint32_t, const char *> names[] = {
+        {ISA_ZICSR, "_zicsr"}, {ISA_ZICNTR, "_zicntr"}, {ISA_ZIFENCEI, "_zifencei"}};
+    for (auto [ext, name] : names)
+        if (isa & ext)
+            result += name;
+
+    return result;
+}
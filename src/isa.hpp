@@ -0,0 +1,41 @@
+#ifndef ISA_HPP
+#define ISA_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Extensions the decoder knows encodings for, as a bitmask. Instructions
+// that share an opcode with the base ISA (M's mul/div, Zifencei's fence.i)
+// are decoded by the base patterns and only tracked for --isa parsing.
+enum IsaExtension : uint32_t
+{
+    ISA_I = 1 << 0,
+    ISA_M = 1 << 1,
+    ISA_A = 1 << 2,
+    ISA_F = 1 << 3,
+    ISA_D = 1 << 4,
+    ISA_C = 1 << 5,
+    ISA_V = 1 << 6,
+    ISA_ZICSR = 1 << 7,
+    ISA_ZICNTR = 1 << 8,
+    ISA_ZIFENCEI = 1 << 9,
+};
+
+inline constexpr uint32_t ISA_G = ISA_I | ISA_M | ISA_A | ISA_F | ISA_D | ISA_ZICSR | ISA_ZIFENCEI;
+
+// rv64gcv_zicsr_zicntr, what the Makefile runs spike with
+inline constexpr uint32_t ISA_ALL = ISA_G | ISA_C | ISA_V | ISA_ZICNTR;
+
+// Parses a spike/GCC style ISA string such as "rv64gc_zicsr". Extensions
+// without any encodings in the decoder are accepted and ignored.
+uint32_t parse_isa(std::string_view isa);
+
+// One extension by name, e.g. "v" or "zicsr"; throws for names the
+// decoder does not know.
+uint32_t parse_extension(std::string_view name);
+
+// canonical spelling of an extension mask, e.g. "rv64imac"
+std::string isa_to_string(uint32_t isa);
+
+#endif
@@ -1,31 +1,288 @@
 #ifndef LINE_PARSER_HPP
 #define LINE_PARSER_HPP
 
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
 #include "line_parse.hpp"
 
-uint32_t extract_instruction_from_line(const std::string &line)
+// spike prints "core   0: 3 0x<16 hex digits> (0x...", which puts the
+// opening parenthesis at this column; other layouts fall back to memchr
+static constexpr std::size_t spike_code_column = 31;
+
+static constexpr uint8_t invalid_nibble = 0xff;
+
+static constexpr std::array<uint8_t, 256> hex_nibble_table = []
+{
+    std::array<uint8_t, 256> table{};
+    table.fill(invalid_nibble);
+    for (int c = '0'; c <= '9'; c++)
+        table[c] = c - '0';
+    for (int c = 'a'; c <= 'f'; c++)
+        table[c] = c - 'a' + 10;
+    for (int c = 'A'; c <= 'F'; c++)
+        table[c] = c - 'A' + 10;
+    return table;
+}();
+
+static std::string_view trim_whitespace(std::string_view str)
+{
+    while (!str.empty() && isspace(static_cast<unsigned char>(str.front())))
+        str.remove_prefix(1);
+    while (!str.empty() && isspace(static_cast<unsigned char>(str.back())))
+        str.remove_suffix(1);
+    return str;
+}
+
+// Handles anything the fast path rejects: whitespace inside the parentheses,
+// decimal codes or misplaced parentheses.
+static bool extract_instruction_slow(std::string_view line, uint32_t &code)
 {
     size_t leftParen = line.find('(');
     size_t rightParen = line.find(')');
-    if (leftParen == std::string::npos || rightParen == std::string::npos || rightParen <= leftParen)
+    if (leftParen == std::string_view::npos || rightParen == std::string_view::npos || rightParen <= leftParen)
+        return false;
+
+    std::string_view hexStr = trim_whitespace(line.substr(leftParen + 1, rightParen - leftParen - 1)); // e.g., "0x07a1"
+    code = 0;
+
+    if (hexStr.starts_with("0x") || hexStr.starts_with("0X"))
+    {
+        std::from_chars(hexStr.data() + 2, hexStr.data() + hexStr.size(), code, 16);
+    }
+    else
+    {
+        std::from_chars(hexStr.data(), hexStr.data() + hexStr.size(), code, 10);
+    }
+    return true;
+}
+
+bool try_extract_instruction_from_line(std::string_view line, uint32_t &code)
+{
+    const char *data = line.data();
+    const char *end = data + line.size();
+
+    const char *paren;
+    if (line.size() > spike_code_column && data[spike_code_column] == '(')
+        paren = data + spike_code_column;
+    else
+        paren = static_cast<const char *>(memchr(data, '(', line.size()));
+
+    // fast path: "(0x" followed by 1-8 hex digits and ')'
+    if (paren && end - paren >= 5 && paren[1] == '0' && (paren[2] | 0x20) == 'x')
+    {
+        const char *digits = paren + 3;
+        const char *limit = std::min(end, digits + 9);
+        uint32_t value = 0;
+        const char *p = digits;
+        for (; p < limit; p++)
+        {
+            uint8_t nibble = hex_nibble_table[static_cast<unsigned char>(*p)];
+            if (nibble == invalid_nibble)
+                break;
+            value = (value << 4) | nibble;
+        }
+        if (p < end && *p == ')' && p != digits && p - digits <= 8)
+        {
+            code = value;
+            return true;
+        }
+    }
+
+    return extract_instruction_slow(line, code);
+}
+
+uint32_t extract_instruction_from_line(std::string_view line)
+{
+    uint32_t code;
+    if (!try_extract_instruction_from_line(line, code))
         throw std::runtime_error("Cannot find instruction code in input line.");
+    return code;
+}
 
-    std::string hexStr = line.substr(leftParen + 1, rightParen - leftParen - 1); // e.g., "0x07a1"
-    uint32_t code = 0;
+static inline void skip_spaces(const char *&p, const char *end)
+{
+    while (p < end && *p == ' ')
+        p++;
+}
 
-    // Remove possible whitespace
-    hexStr.erase(remove_if(hexStr.begin(), hexStr.end(), isspace), hexStr.end());
+static inline const char *token_end(const char *p, const char *end)
+{
+    while (p < end && *p != ' ')
+        p++;
+    return p;
+}
+
+static inline bool parse_dec(const char *&p, const char *end, uint32_t &value)
+{
+    const char *start = p;
+    uint32_t result = 0;
+    while (p < end && static_cast<unsigned>(*p - '0') < 10)
+        result = result * 10 + (*p++ - '0');
+    value = result;
+    return p != start;
+}
 
-    std::stringstream ss(hexStr);
-    if (hexStr.compare(0, 2, "0x") == 0 || hexStr.compare(0, 2, "0X") == 0)
+// Parses "0x<digits>"; only the low 64 bits of longer values are kept.
+static inline bool parse_hex(const char *&p, const char *end, uint64_t &value)
+{
+    if (end - p < 3 || p[0] != '0' || (p[1] | 0x20) != 'x')
+        return false;
+    p += 2;
+    const char *start = p;
+    uint64_t result = 0;
+    uint8_t nibble;
+    while (p < end && (nibble = hex_nibble_table[static_cast<unsigned char>(*p)]) != invalid_nibble)
     {
-        ss >> std::hex >> code;
+        result = (result << 4) | nibble;
+        p++;
     }
+    value = result;
+    return p != start;
+}
+
+static inline bool starts_hex(const char *p, const char *end)
+{
+    return end - p >= 3 && p[0] == '0' && (p[1] | 0x20) == 'x';
+}
+
+bool try_extract_pc_from_line(std::string_view line, uint64_t &pc)
+{
+    const char *data = line.data();
+    const char *paren;
+    if (line.size() > spike_code_column && data[spike_code_column] == '(')
+        paren = data + spike_code_column;
     else
+        paren = static_cast<const char *>(memchr(data, '(', line.size()));
+    if (!paren)
+        return false;
+
+    // back over the spaces and hex digits to the "0x" of the pc
+    const char *p = paren;
+    while (p > data && p[-1] == ' ')
+        p--;
+    const char *digits_end = p;
+    while (p > data && hex_nibble_table[static_cast<unsigned char>(p[-1])] != invalid_nibble)
+        p--;
+    if (p == digits_end || p - data < 2 || (p[-1] | 0x20) != 'x' || p[-2] != '0')
+        return false;
+    p -= 2;
+    return parse_hex(p, digits_end, pc);
+}
+
+bool parse_trace_record(std::string_view line, TraceRecord &record)
+{
+    const char *p = line.data();
+    const char *end = p + line.size();
+    uint32_t number;
+    uint64_t value;
+
+    record.reg_write_count = 0;
+    record.mem_access_count = 0;
+    record.truncated = false;
+
+    if (end - p < 4 || memcmp(p, "core", 4) != 0)
+        return false;
+    p += 4;
+    skip_spaces(p, end);
+    if (!parse_dec(p, end, number) || p == end || *p++ != ':')
+        return false;
+    record.core = static_cast<uint16_t>(number);
+    skip_spaces(p, end);
+
+    // the privilege level is missing from plain instruction logs
+    record.priv = TraceRecord::unknown_priv;
+    if (!starts_hex(p, end))
     {
-        ss >> code;
+        if (!parse_dec(p, end, number))
+            return false;
+        record.priv = static_cast<uint8_t>(number);
+        skip_spaces(p, end);
     }
-    return code;
+
+    if (!parse_hex(p, end, record.pc))
+        return false;
+    skip_spaces(p, end);
+    if (p == end || *p++ != '(' || !parse_hex(p, end, value) || p == end || *p++ != ')')
+        return false;
+    record.code = static_cast<uint32_t>(value);
+
+    for (;;)
+    {
+        skip_spaces(p, end);
+        if (p == end)
+            break;
+
+        const char *tok = p;
+        const char *tok_end = token_end(p, end);
+
+        if (tok_end - tok == 3 && memcmp(tok, "mem", 3) == 0)
+        {
+            p = tok_end;
+            skip_spaces(p, end);
+            MemAccess access{};
+            if (!parse_hex(p, end, access.addr))
+                return false;
+            const char *after_addr = p;
+            skip_spaces(p, end);
+            // stores print the written value after the address
+            if (starts_hex(p, end))
+            {
+                parse_hex(p, end, access.data);
+                access.store = true;
+            }
+            else
+            {
+                p = after_addr;
+            }
+            if (record.mem_access_count < TraceRecord::max_mem_accesses)
+                record.mem_accesses[record.mem_access_count++] = access;
+            else
+                record.truncated = true;
+            continue;
+        }
+
+        RegFile file;
+        bool is_reg = tok_end - tok >= 2 && static_cast<unsigned>(tok[1] - '0') < 10;
+        switch (is_reg ? *tok : 0)
+        {
+        case 'x':
+            file = RegFile::X;
+            break;
+        case 'f':
+            file = RegFile::F;
+            break;
+        case 'v':
+            file = RegFile::V;
+            break;
+        case 'c':
+            // CSR writes are printed as c<num>_<name>
+            file = RegFile::CSR;
+            break;
+        default:
+            // vector config prefix (e32 m1 l4) and anything unknown
+            p = tok_end;
+            continue;
+        }
+
+        p = tok + 1;
+        parse_dec(p, end, number);
+        p = tok_end;
+        skip_spaces(p, end);
+        if (!parse_hex(p, end, value))
+            continue;
+
+        if (record.reg_write_count < TraceRecord::max_reg_writes)
+            record.reg_writes[record.reg_write_count++] = RegWrite{value, static_cast<uint16_t>(number), file};
+        else
+            record.truncated = true;
+    }
+
+    return true;
 }
 
-#endif // LINE_PARSER_HPP
\ No newline at end of file
+#endif // LINE_PARSER_HPP
@@ -2,11 +2,64 @@
 #define LINE_PARSE_HPP
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <iostream>
-#include <sstream>
 #include <algorithm>
 
-uint32_t extract_instruction_from_line(const std::string &line);
+uint32_t extract_instruction_from_line(std::string_view line);
 
-#endif
\ No newline at end of file
+// Same as extract_instruction_from_line, but reports a line without an
+// instruction code by returning false instead of throwing.
+bool try_extract_instruction_from_line(std::string_view line, uint32_t &code);
+
+// The pc in front of the "(0x<code>)" of a spike line, without parsing the
+// rest of the record. Returns false for lines without one.
+bool try_extract_pc_from_line(std::string_view line, uint64_t &pc);
+
+enum class RegFile : uint8_t
+{
+    X,
+    F,
+    V,
+    CSR
+};
+
+struct RegWrite
+{
+    uint64_t value; // vector registers wider than 64 bits keep the low 64 bits
+    uint16_t num;   // register or CSR number
+    RegFile file;
+};
+
+struct MemAccess
+{
+    uint64_t addr;
+    uint64_t data; // only meaningful for stores
+    bool store;
+};
+
+// Every field of one spike --log-commits line, e.g.
+// "core   0: 3 0x0000000080000110 (0x00113423) mem 0x0000000080021f68 0x0000000000000000"
+struct TraceRecord
+{
+    static constexpr std::size_t max_reg_writes = 4;
+    static constexpr std::size_t max_mem_accesses = 2;
+    static constexpr uint8_t unknown_priv = 0xff;
+
+    uint64_t pc;
+    uint32_t code;
+    uint16_t core;
+    uint8_t priv;
+    uint8_t reg_write_count;
+    uint8_t mem_access_count;
+    bool truncated; // more writes or accesses than fit were dropped
+    RegWrite reg_writes[max_reg_writes];
+    MemAccess mem_accesses[max_mem_accesses];
+};
+
+// Single left-to-right scan of a commit log line. Returns false when the
+// line does not start with "core N: [priv] 0x<pc> (0x<code>)".
+bool parse_trace_record(std::string_view line, TraceRecord &record);
+
+#endif
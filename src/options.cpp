@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <iostream>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+#include "options.hpp"
+
+void print_usage(const char *program)
+{
+    std::cerr << "Usage: " << program << " [options] <log_file_path | - | fifo>\n"
+              << "Options:\n"
+              << "  -j N           decode with N threads (0 = all cores); for compressed\n"
+              << "                 input, pipeline with N zstd decompression threads\n"
+              << "  --huge-pages   request huge pages for the trace mapping\n"
+              << "  --decode-cache memoize decoded instructions by instruction word\n"
+              << "  --pipeline     read, parse, decode and write on separate threads\n"
+              << "  --isa ISA      decode only the extensions in ISA (default rv64gcv_zicsr_zicntr)\n"
+              << "  --strict       stop at the first unknown instruction or unparsable line\n"
+              << "  --emit-binary FILE\n"
+              << "                 convert the trace to the binary .rvtb format instead of decoding;\n"
+              << "                 .rvtb files are recognised as input automatically\n"
+              << "  --export-arrow FILE\n"
+              << "                 write the decoded trace as an Arrow IPC file (one row per\n"
+              << "                 instruction) instead of the listing\n"
+              << "  --stats        print the instruction mix by mnemonic, format and opcode\n"
+              << "                 class instead of the listing\n"
+              << "  --intern       hold the trace as IDs into a dictionary of distinct words,\n"
+              << "                 each decoded and rendered once\n"
+              << "  --index        write a <trace>.idx seek index while decoding\n"
+              << "  --filter-mnemonic LIST\n"
+              << "                 only decode the comma separated mnemonics; NAME* is a prefix\n"
+              << "                 (e.g. V_*,ADDI)\n"
+              << "  --filter-format LIST\n"
+              << "                 only decode instructions of these formats (e.g. CI,CR)\n"
+              << "  --filter-ext LIST\n"
+              << "                 only decode instructions of these extensions (e.g. v,zicsr)\n"
+              << "  --filter-pc A:B\n"
+              << "                 only decode instructions with A <= pc < B (hex with 0x)\n"
+              << "  --filter-compressed, --filter-uncompressed\n"
+              << "                 only decode compressed or uncompressed instructions\n"
+              << "  --roi MARKER   skip ahead to the first line matching MARKER and stop after the\n"
+              << "                 next one: word:0x<hex> (a magic instruction word), pc:0x<hex>\n"
+              << "                 or counter (the first rdcycle/rdinstret)\n"
+              << "  --roi-end MARKER\n"
+              << "                 end the region at MARKER instead\n"
+              << "  --range A:B    decode only lines A to B-1 (0-based, B may be empty for the\n"
+              << "                 end), seeking with the index; builds it first if needed\n";
+}
+
+static unsigned parse_unsigned(std::string_view value, std::string_view option)
+{
+    unsigned result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size())
+    {
+        throw std::runtime_error("Invalid value for " + std::string(option) + ": " + std::string(value));
+    }
+    return result;
+}
+
+static uint64_t parse_u64(std::string_view value, std::string_view option)
+{
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (ec != std::errc() || ptr != value.data() + value.size())
+    {
+        throw std::runtime_error("Invalid value for " + std::string(option) + ": " + std::string(value));
+    }
+    return result;
+}
+
+// "A:B", "A:" or ":B"
+static void parse_range(std::string_view value, Options &options)
+{
+    const std::size_t colon = value.find(':');
+    if (colon == std::string_view::npos)
+    {
+        throw std::runtime_error("Invalid value for --range, expected START:END: " + std::string(value));
+    }
+    std::string_view first = value.substr(0, colon);
+    std::string_view last = value.substr(colon + 1);
+    options.has_range = true;
+    options.range_first = first.empty() ? 0 : parse_u64(first, "--range");
+    options.range_last = last.empty() ? UINT64_MAX : parse_u64(last, "--range");
+    if (options.range_last < options.range_first)
+    {
+        throw std::runtime_error("Invalid value for --range, END is before START: " + std::string(value));
+    }
+}
+
+// decimal, or hex with a 0x prefix
+static uint64_t parse_address(std::string_view value, std::string_view option)
+{
+    int base = 10;
+    if (value.starts_with("0x") || value.starts_with("0X"))
+    {
+        value.remove_prefix(2);
+        base = 16;
+    }
+    uint64_t result = 0;
+    auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), result, base);
+    if (value.empty() || ec != std::errc() || ptr != value.data() + value.size())
+    {
+        throw std::runtime_error("Invalid value for " + std::string(option) + ": " + std::string(value));
+    }
+    return result;
+}
+
+// "A:B", "A:" or ":B"
+static void parse_pc_range(std::string_view value, Options &options)
+{
+    const std::size_t colon = value.find(':');
+    if (colon == std::string_view::npos)
+    {
+        throw std::runtime_error("Invalid value for --filter-pc, expected START:END: " + std::string(value));
+    }
+    std::string_view first = value.substr(0, colon);
+    std::string_view last = value.substr(colon + 1);
+    options.filter.set_pc_range(first.empty() ? 0 : parse_address(first, "--filter-pc"),
+                                last.empty() ? UINT64_MAX : parse_address(last, "--filter-pc"));
+}
+
+// The value of "name VALUE" or "name=VALUE". Returns false if arg is not
+// option name.
+static bool option_value(std::string_view arg, std::string_view name, int argc, char *argv[], int &i,
+                         std::string_view &value)
+{
+    if (arg == name)
+    {
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for " + std::string(name));
+        value = argv[++i];
+        return true;
+    }
+    if (arg.starts_with(name) && arg.size() > name.size() && arg[name.size()] == '=')
+    {
+        value = arg.substr(name.size() + 1);
+        return true;
+    }
+    return false;
+}
+
+Options parse_options(int argc, char *argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string_view arg = argv[i];
+        std::string_view value;
+        if (arg == "--huge-pages")
+        {
+            options.huge_pages = true;
+        }
+        else if (arg == "--decode-cache")
+        {
+            options.decode_cache = true;
+        }
+        else if (arg == "--pipeline")
+        {
+            options.pipeline = true;
+        }
+        else if (arg == "--strict")
+        {
+            options.strict = true;
+        }
+        else if (option_value(arg, "--isa", argc, argv, i, value))
+        {
+            options.isa = parse_isa(value);
+        }
+        else if (option_value(arg, "--emit-binary", argc, argv, i, value))
+        {
+            options.emit_binary = value;
+        }
+        else if (option_value(arg, "--export-arrow", argc, argv, i, value))
+        {
+            options.export_arrow = value;
+        }
+        else if (arg == "--stats")
+        {
+            options.stats = true;
+        }
+        else if (arg == "--intern")
+        {
+            options.intern = true;
+        }
+        else if (arg == "--index")
+        {
+            options.build_index = true;
+        }
+        else if (option_value(arg, "--range", argc, argv, i, value))
+        {
+            parse_range(value, options);
+        }
+        else if (option_value(arg, "--filter-mnemonic", argc, argv, i, value))
+        {
+            options.filter.add_mnemonics(value);
+        }
+        else if (option_value(arg, "--filter-format", argc, argv, i, value))
+        {
+            options.filter.add_formats(value);
+        }
+        else if (option_value(arg, "--filter-ext", argc, argv, i, value))
+        {
+            options.filter.add_extensions(value);
+        }
+        else if (option_value(arg, "--filter-pc", argc, argv, i, value))
+        {
+            parse_pc_range(value, options);
+        }
+        else if (option_value(arg, "--roi", argc, argv, i, value))
+        {
+            options.roi_start = parse_roi_marker(value);
+        }
+        else if (option_value(arg, "--roi-end", argc, argv, i, value))
+        {
+            options.roi_end = parse_roi_marker(value);
+        }
+        else if (arg == "--filter-compressed")
+        {
+            options.filter.set_compressed(true);
+        }
+        else if (arg == "--filter-uncompressed")
+        {
+            options.filter.set_compressed(false);
+        }
+        else if (arg == "-j")
+        {
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value for -j");
+            options.jobs = parse_unsigned(argv[++i], arg);
+        }
+        else if (arg.starts_with("-j"))
+        {
+            options.jobs = parse_unsigned(arg.substr(2), "-j");
+        }
+        else if (arg.starts_with("-") && arg.size() > 1)
+        {
+            throw std::runtime_error("Unknown option: " + std::string(arg));
+        }
+        else
+        {
+            options.file_name = arg;
+        }
+    }
+
+    if (options.file_name.empty())
+    {
+        throw std::runtime_error("Missing log file path");
+    }
+
+    if (options.jobs == 0)
+    {
+        options.jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    if (options.pipeline && options.jobs > 1)
+    {
+        throw std::runtime_error("--pipeline cannot be combined with -j");
+    }
+
+    if (options.intern && (options.pipeline || options.jobs > 1 || options.has_range || options.build_index))
+    {
+        throw std::runtime_error("--intern cannot be combined with -j, --pipeline, --range or --index");
+    }
+
+    if (!options.emit_binary.empty() &&
+        (options.has_range || options.jobs > 1 || options.pipeline || options.intern || options.build_index))
+    {
+        throw std::runtime_error("--emit-binary cannot be combined with --range, -j, --pipeline, --intern or --index");
+    }
+
+    if (!options.export_arrow.empty() && !options.emit_binary.empty())
+    {
+        throw std::runtime_error("--export-arrow cannot be combined with --emit-binary");
+    }
+
+    if (!options.export_arrow.empty() &&
+        (options.has_range || options.jobs > 1 || options.pipeline || options.build_index))
+    {
+        throw std::runtime_error("--export-arrow cannot be combined with --range, -j, --pipeline or --index");
+    }
+
+    if (options.roi_end.is_set() && !options.roi_start.is_set())
+    {
+        throw std::runtime_error("--roi-end needs --roi");
+    }
+
+    if (options.roi_start.is_set() && (options.has_range || options.intern || !options.emit_binary.empty() ||
+                                       !options.export_arrow.empty()))
+    {
+        throw std::runtime_error("--roi cannot be combined with --range, --intern, --emit-binary or --export-arrow");
+    }
+
+    if (options.filter.is_active() && (options.pipeline || options.intern || !options.emit_binary.empty() ||
+                                       !options.export_arrow.empty()))
+    {
+        throw std::runtime_error("--filter-* cannot be combined with --pipeline, --intern, --emit-binary or --export-arrow");
+    }
+
+    if (options.stats && (options.pipeline || options.decode_cache || !options.emit_binary.empty() ||
+                          !options.export_arrow.empty()))
+    {
+        throw std::runtime_error(
+            "--stats cannot be combined with --pipeline, --decode-cache, --emit-binary or --export-arrow");
+    }
+
+    return options;
+}
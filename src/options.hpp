@@ -0,0 +1,49 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "instruction_filter.hpp"
+#include "isa.hpp"
+#include "roi.hpp"
+
+struct Options
+{
+    std::string file_name;
+    bool huge_pages = false;
+    // number of decoding threads, 1 keeps the serial line-by-line path
+    unsigned jobs = 1;
+    bool decode_cache = false;
+    // read/parse/decode/write on separate threads
+    bool pipeline = false;
+    // extensions to decode, from --isa
+    uint32_t isa = ISA_ALL;
+    // abort on the first unknown encoding or unparsable line
+    bool strict = false;
+    // convert the trace to this .rvtb file instead of decoding it
+    std::string emit_binary;
+    // write the decoded trace to this Arrow IPC file instead of a listing
+    std::string export_arrow;
+    // print instruction mix histograms instead of the listing
+    bool stats = false;
+    // decode every distinct word once and keep the trace as an ID stream
+    bool intern = false;
+    // write the <trace>.idx sidecar while decoding
+    bool build_index = false;
+    // only decode lines [range_first, range_last), from --range
+    bool has_range = false;
+    uint64_t range_first = 0;
+    uint64_t range_last = UINT64_MAX;
+    // from the --filter-* options
+    InstructionFilter filter;
+    // only decode from roi_start to roi_end (default: the next roi_start)
+    RoiMarker roi_start;
+    RoiMarker roi_end;
+};
+
+void print_usage(const char *program);
+
+Options parse_options(int argc, char *argv[]);
+
+#endif
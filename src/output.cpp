@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "output.hpp"
+
+OutputBuffer::OutputBuffer(int fd, std::size_t capacity)
+    : m_fd(fd), m_capacity(capacity)
+{
+    if (m_fd >= 0)
+        m_buffer.reserve(m_capacity);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    try
+    {
+        flush();
+    }
+    catch (...)
+    {
+        // nothing sensible left to do with a failed write during teardown
+    }
+}
+
+void OutputBuffer::write_fd(const char *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = ::write(m_fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error("Could not write output");
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+void OutputBuffer::write(std::string_view str)
+{
+    if (m_fd >= 0 && m_buffer.size() + str.size() > m_capacity)
+    {
+        flush();
+        // large blocks (whole decoded chunks) bypass the buffer
+        if (str.size() >= m_capacity)
+        {
+            write_fd(str.data(), str.size());
+            return;
+        }
+    }
+    m_buffer.append(str);
+}
+
+void OutputBuffer::write_hex(uint32_t value)
+{
+    char digits[8];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value, 16);
+    std::transform(digits, end, digits, [](char c)
+                   { return c >= 'a' ? static_cast<char>(c - 'a' + 'A') : c; });
+    write(std::string_view(digits, end - digits));
+}
+
+void OutputBuffer::flush()
+{
+    if (m_fd < 0 || m_buffer.empty())
+        return;
+    write_fd(m_buffer.data(), m_buffer.size());
+    m_buffer.clear();
+}
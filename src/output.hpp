@@ -0,0 +1,98 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Accumulates the decoded listing in a large user-space buffer. With a file
+// descriptor the buffer is written out whenever it fills up (and on flush),
+// never per line; without one it only collects text, e.g. per chunk when
+// decoding in parallel.
+class OutputBuffer
+{
+private:
+    std::string m_buffer;
+    int m_fd;
+    std::size_t m_capacity;
+
+    void write_fd(const char *data, std::size_t size);
+
+public:
+    static constexpr std::size_t default_capacity = 1 << 20;
+
+    explicit OutputBuffer(int fd = -1, std::size_t capacity = default_capacity);
+
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &) = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void write(std::string_view str);
+
+    void put(char c)
+    {
+        m_buffer.push_back(c);
+        if (m_fd >= 0 && m_buffer.size() >= m_capacity)
+            flush();
+    }
+
+    // uppercase hexadecimal without prefix, same as uint32_t_to_hex
+    void write_hex(uint32_t value);
+
+    template <typename T>
+        requires std::is_integral_v<T>
+    void write_dec(T value)
+    {
+        char digits[24];
+        auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+        write(std::string_view(digits, end - digits));
+    }
+
+    void flush();
+
+    // buffered text, only meaningful without a file descriptor
+    std::string_view view() const { return m_buffer; }
+
+    void clear() { m_buffer.clear(); }
+
+    // hands the buffered text over without copying it
+    std::string release() { return std::exchange(m_buffer, std::string()); }
+
+    OutputBuffer &operator<<(std::string_view str)
+    {
+        write(str);
+        return *this;
+    }
+
+    OutputBuffer &operator<<(const char *str)
+    {
+        write(str);
+        return *this;
+    }
+
+    OutputBuffer &operator<<(const std::string &str)
+    {
+        write(str);
+        return *this;
+    }
+
+    OutputBuffer &operator<<(char c)
+    {
+        put(c);
+        return *this;
+    }
+
+    template <typename T>
+        requires std::is_integral_v<T>
+    OutputBuffer &operator<<(T value)
+    {
+        write_dec(value);
+        return *this;
+    }
+};
+
+#endif
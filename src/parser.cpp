@@ -1,10 +1,25 @@
+#include <charconv>
 #include <iostream>
 #include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
 
 #include "reader.hpp"
+#include "decompress.hpp"
+#include "binary_trace.hpp"
 #include "line_parse.hpp"
-#include "instructions.hpp"
-#include "decoder.hpp"
+#include "trace_index.hpp"
+#include "instruction_dictionary.hpp"
+#include "arrow_export.hpp"
+#include "instruction_stats.hpp"
+#include "roi.hpp"
+#include "options.hpp"
+#include "chunk_decoder.hpp"
+#include "pipeline.hpp"
+#include "output.hpp"
 
 void print_progress_bar(float progress)
 {
@@ -24,53 +39,611 @@ void print_progress_bar(float progress)
     std::cerr.flush();
 }
 
+// Decodes line by line on the calling thread. size is the input size for
+// the progress bar, 0 for streams.
+template <typename Reader>
+static void decode_serial(Reader &reader, std::size_t size, const DecodeConfig &config, bool use_cache,
+                          OutputBuffer &out, DecodeCounts &counts)
+{
+    std::unique_ptr<DecodeCache> cache = use_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+    std::string_view line;
+    // counts every line read, listed or not, so skipped lines cannot
+    // hold the progress bar on one value and redraw it each time
+    uint64_t lines = 0;
+    while (reader.get_next_line(line))
+    {
+        decode_line(line, config, out, counts, cache.get());
+
+        if (size && ++lines % 100000 == 0)
+        {
+            // Show loading bar
+            float progress = (float)reader.get_offset() / size;
+            print_progress_bar(progress);
+        }
+    }
+    if (cache)
+    {
+        counts.cache_hits = cache->get_hits();
+        counts.cache_misses = cache->get_misses();
+    }
+}
+
+// stands in for the text line in strict-mode errors on .rvtb input
+static std::string binary_record_name(uint64_t pc)
+{
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), pc, 16);
+    return "record at pc 0x" + std::string(digits, end);
+}
+
+// Keeps the records of a .rvtb block that lie in the region of interest
+// (if roi is set) and that config.filter accepts.
+static void select_records(TraceBlock &block, const DecodeConfig &config, RoiScanner *roi, DecodeCounts &counts)
+{
+    std::size_t begin = 0;
+    std::size_t end = block.codes.size();
+    if (roi)
+        roi->clip_records(block.codes, block.pcs, begin, end);
+
+    std::size_t kept = 0;
+    for (std::size_t i = begin; i < end; i++)
+    {
+        if (config.filter && !config.filter->accepts(block.codes[i], block.pcs[i], *config.decoder))
+        {
+            counts.filtered++;
+            continue;
+        }
+        block.codes[kept] = block.codes[i];
+        block.pcs[kept] = block.pcs[i];
+        kept++;
+    }
+    block.codes.resize(kept);
+    block.pcs.resize(kept);
+}
+
+// Decodes a .rvtb trace a block at a time: the words come straight out of
+// the block dictionary, so there is no text left to parse.
+static void decode_binary(BinaryTraceReader &reader, std::size_t size, const DecodeConfig &config, bool use_cache,
+                          RoiScanner *roi, OutputBuffer &out, DecodeCounts &counts)
+{
+    std::unique_ptr<DecodeCache> cache = use_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+    TraceBlock block;
+    std::vector<DecodedInstruction> insts;
+    while (!(roi && roi->done()) && reader.read_block(block))
+    {
+        select_records(block, config, roi, counts);
+        insts.assign(block.codes.size(), DecodedInstruction{});
+        if (cache)
+        {
+            for (std::size_t i = 0; i < block.codes.size(); i++)
+                cache->decode(block.codes[i], insts[i]);
+        }
+        else
+        {
+            config.decoder->decode_batch(block.codes, insts);
+        }
+
+        for (std::size_t i = 0; i < insts.size(); i++)
+        {
+            if (!insts[i].is_known())
+            {
+                if (config.strict)
+                    fail_line(DecodeStatus::UNKNOWN_ENCODING, block.codes[i], binary_record_name(block.pcs[i]));
+                counts.unknown.record(block.codes[i]);
+            }
+            print_listing_line(insts[i], out, counts);
+        }
+        print_progress_bar((float)reader.get_offset() / size);
+    }
+    if (cache)
+    {
+        counts.cache_hits = cache->get_hits();
+        counts.cache_misses = cache->get_misses();
+    }
+}
+
+// Converts a text trace into a .rvtb file. Lines without the "core N:"
+// prefix keep just their instruction word.
+static void emit_binary(StreamReader &reader, const DecodeConfig &config, BinaryTraceWriter &writer,
+                        DecodeCounts &counts)
+{
+    std::string_view line;
+    TraceRecord record;
+    while (reader.get_next_line(line))
+    {
+        if (!parse_trace_record(line, record))
+        {
+            record = TraceRecord{};
+            record.priv = TraceRecord::unknown_priv;
+            if (!try_extract_instruction_from_line(line, record.code))
+            {
+                if (config.strict)
+                    fail_line(DecodeStatus::NO_INSTRUCTION, 0, line);
+                counts.bad_lines++;
+                continue;
+            }
+        }
+        writer.add(record);
+        counts.count++;
+    }
+    writer.finish();
+}
+
+// --stats on .rvtb input: block words go straight into the histograms.
+static void collect_stats_binary(BinaryTraceReader &reader, std::size_t size, const DecodeConfig &config,
+                                 RoiScanner *roi, InstructionStats &stats, DecodeCounts &counts)
+{
+    TraceBlock block;
+    std::vector<DecodedInstruction> insts;
+    while (!(roi && roi->done()) && reader.read_block(block))
+    {
+        select_records(block, config, roi, counts);
+        insts.resize(block.codes.size());
+        const std::size_t unknown = config.decoder->decode_batch(block.codes, insts);
+        add_stats_batch(insts, unknown, config, [&](std::size_t i)
+                        { return binary_record_name(block.pcs[i]); }, stats, counts);
+        print_progress_bar((float)reader.get_offset() / size);
+    }
+}
+
+// Decodes a stream or compressed file one read block at a time, for
+// --stats or to cut out the region of interest (roi may be null). Reading
+// stops as soon as the region is left.
+static void decode_stream_blocks(StreamReader &reader, const Options &options, const DecodeConfig &config,
+                                 RoiScanner *roi, OutputBuffer &out, DecodeCounts &counts, InstructionStats &stats)
+{
+    std::unique_ptr<DecodeCache> cache =
+        options.decode_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+    std::string block;
+    while (!(roi && roi->done()) && reader.read_block(block))
+    {
+        const std::string_view region = roi ? roi->clip(block) : block;
+        if (options.stats)
+            collect_stats_chunk(region, config, stats, counts);
+        else
+            decode_chunk(region, config, out, counts, cache.get());
+    }
+    if (cache)
+    {
+        counts.cache_hits = cache->get_hits();
+        counts.cache_misses = cache->get_misses();
+    }
+}
+
+// Adds one decoded row to the Arrow export; the dictionary decodes each
+// distinct word once. line() names the record in a --strict error.
+template <typename Line>
+static void export_row(uint64_t pc, uint32_t code, Line line, InstructionDictionary &dictionary,
+                       const DecodeConfig &config, ArrowTraceWriter &writer, DecodeCounts &counts)
+{
+    const DecodedInstruction &inst = dictionary.instruction(dictionary.intern(code));
+    if (!inst.is_known())
+    {
+        if (config.strict)
+            fail_line(DecodeStatus::UNKNOWN_ENCODING, code, line());
+        counts.unknown.record(code);
+    }
+    if (inst.compressed)
+        counts.count_compressed++;
+    writer.add(pc, inst);
+    counts.count++;
+}
+
+// --export-arrow: decodes a text, compressed or .rvtb trace into an Arrow
+// IPC file. Text lines without the "core N:" prefix get pc 0.
+static void export_arrow(const Options &options, const DecodeConfig &config, ArrowTraceWriter &writer,
+                         DecodeCounts &counts)
+{
+    InstructionDictionary dictionary(*config.decoder);
+    std::unique_ptr<FileReader> file_reader;
+    if (!is_stream_input(options.file_name))
+        file_reader = std::make_unique<FileReader>(options.file_name, options.huge_pages);
+
+    if (file_reader && is_binary_trace(file_reader->get_data()))
+    {
+        BinaryTraceReader binary_reader(file_reader->get_data());
+        TraceBlock block;
+        while (binary_reader.read_block(block))
+        {
+            for (std::size_t i = 0; i < block.codes.size(); i++)
+            {
+                export_row(
+                    block.pcs[i], block.codes[i], [&]
+                    { return binary_record_name(block.pcs[i]); },
+                    dictionary, config, writer, counts);
+            }
+        }
+    }
+    else
+    {
+        StreamReader stream_reader(options.file_name);
+        std::string_view line;
+        TraceRecord record;
+        while (stream_reader.get_next_line(line))
+        {
+            if (!parse_trace_record(line, record))
+            {
+                record.pc = 0;
+                if (!try_extract_instruction_from_line(line, record.code))
+                {
+                    if (config.strict)
+                        fail_line(DecodeStatus::NO_INSTRUCTION, 0, line);
+                    counts.bad_lines++;
+                    continue;
+                }
+            }
+            export_row(
+                record.pc, record.code, [&]
+                { return line; },
+                dictionary, config, writer, counts);
+        }
+    }
+    writer.finish();
+}
+
+// The index is only a cache, so failing to write it never fails the run.
+static void save_trace_index_or_warn(const std::string &trace_name, const TraceIndex &index)
+{
+    try
+    {
+        save_trace_index(trace_name, index);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "warning: " << e.what() << std::endl;
+    }
+}
+
+// Decodes a plain text trace, or with --range only the requested lines,
+// found through the sidecar index (built and saved first if missing or
+// stale). --index builds the sidecar on a second thread during the parse.
+// With roi only the region of interest is decoded, in any mode.
+static void decode_text_file(FileReader &file_reader, const Options &options, const DecodeConfig &config,
+                             RoiScanner *roi, OutputBuffer &out, DecodeCounts &counts, PipelineStats &pipeline_stats,
+                             InstructionStats &stats)
+{
+    std::string_view data = file_reader.get_data();
+    TraceIndex index;
+    std::jthread index_builder;
+    if (options.has_range)
+    {
+        if (!load_trace_index(options.file_name, index))
+        {
+            index = build_trace_index(options.file_name, data);
+            save_trace_index_or_warn(options.file_name, index);
+        }
+        data = index.slice(data, options.range_first, options.range_last);
+    }
+    else if (options.build_index)
+    {
+        index_builder = std::jthread([&]
+                                     { index = build_trace_index(options.file_name, data); });
+    }
+    if (roi)
+        data = roi->clip(data);
+
+    auto show_progress = [&](std::size_t offset)
+    { print_progress_bar((float)offset / data.size()); };
+
+    if (options.stats)
+        collect_stats(data, config, options.jobs, stats, counts, show_progress);
+    else if (options.pipeline)
+        decode_pipeline(data, config, options.decode_cache, out, counts, show_progress, pipeline_stats);
+    else if (options.jobs > 1)
+        decode_parallel(data, config, options.jobs, options.decode_cache, out, counts, show_progress);
+    else if (options.has_range || roi)
+    {
+        std::unique_ptr<DecodeCache> cache =
+            options.decode_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+        decode_chunk(data, config, out, counts, cache.get());
+        if (cache)
+        {
+            counts.cache_hits = cache->get_hits();
+            counts.cache_misses = cache->get_misses();
+        }
+    }
+    else
+        decode_serial(file_reader, file_reader.get_size(), config, options.decode_cache, out, counts);
+
+    if (index_builder.joinable())
+    {
+        index_builder.join();
+        save_trace_index_or_warn(options.file_name, index);
+    }
+}
+
+struct InternSummary
+{
+    std::size_t unique = 0;
+    std::size_t id_bytes = 0;
+    std::size_t dictionary_bytes = 0;
+};
+
+static void print_intern_summary(const InternSummary &summary, const DecodeCounts &counts)
+{
+    std::cerr << "distinct instructions: " << summary.unique << ", ID stream: " << summary.id_bytes
+              << " bytes, dictionary: " << summary.dictionary_bytes << " bytes (one decoded instruction per line: "
+              << counts.count * sizeof(DecodedInstruction) << " bytes)" << std::endl;
+}
+
+// --intern: reads the whole trace into an InternedTrace, then writes the
+// listing, the --stats histograms or, with writer, the Arrow rows from the
+// ID stream; no instruction is decoded twice. Whatever was read before an
+// error is still written, as on the other paths.
+static void decode_interned(const Options &options, const DecodeConfig &config, OutputBuffer &out,
+                            DecodeCounts &counts, InternSummary &summary, InstructionStats &stats,
+                            ArrowTraceWriter *writer)
+{
+    InternedTrace trace(*config.decoder);
+    trace.keep_pcs = writer != nullptr;
+    std::exception_ptr error;
+    try
+    {
+        std::unique_ptr<FileReader> file_reader;
+        std::string_view data;
+        if (!is_stream_input(options.file_name))
+        {
+            file_reader = std::make_unique<FileReader>(options.file_name, options.huge_pages);
+            data = file_reader->get_data();
+        }
+
+        if (file_reader && is_binary_trace(data))
+        {
+            BinaryTraceReader binary_reader(data);
+            TraceBlock block;
+            while (binary_reader.read_block(block))
+            {
+                for (std::size_t i = 0; i < block.codes.size(); i++)
+                {
+                    const uint32_t id = trace.dictionary.intern(block.codes[i]);
+                    if (config.strict && !trace.dictionary.instruction(id).is_known())
+                        fail_line(DecodeStatus::UNKNOWN_ENCODING, block.codes[i], binary_record_name(block.pcs[i]));
+                    trace.ids.push_back(id);
+                    if (trace.keep_pcs)
+                        trace.pcs.push_back(block.pcs[i]);
+                }
+            }
+        }
+        else if (file_reader && detect_compression(data.substr(0, compression_magic_size)) == Compression::NONE)
+        {
+            intern_lines(data, config, trace, counts);
+        }
+        else
+        {
+            StreamReader stream_reader(options.file_name);
+            std::string block;
+            while (stream_reader.read_block(block))
+                intern_lines(block, config, trace, counts);
+        }
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    if (writer)
+    {
+        for (std::size_t i = 0; i < trace.ids.size(); i++)
+            writer->add(trace.pcs[i], trace.dictionary.instruction(trace.ids[i]));
+        add_interned_counts(trace, count_occurrences(trace), counts);
+        if (!error)
+            writer->finish();
+    }
+    else if (options.stats)
+        collect_interned_stats(trace, stats, counts);
+    else
+        write_interned_listing(trace, out, counts);
+    summary.unique = trace.dictionary.size();
+    summary.id_bytes = trace.ids.size() * sizeof(uint32_t);
+    summary.dictionary_bytes = trace.dictionary.memory_usage();
+    if (error)
+        std::rethrow_exception(error);
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc < 2)
+    Options options;
+    try
+    {
+        options = parse_options(argc, argv);
+    }
+    catch (const std::exception &e)
     {
-        std::cerr << "Usage: " << argv[0] << " <log_file_path>\n";
+        std::cerr << e.what() << "\n";
+        print_usage(argv[0]);
         return 1;
     }
-    std::string file_name = argv[1];
 
-    auto file_reader = FileReader(file_name);
-    std::string line;
-    uint32_t code;
-    size_t count_compressed = 0;
-    size_t count = 0;
+    OutputBuffer out(STDOUT_FILENO);
+    DecodeCounts counts;
+    PipelineStats pipeline_stats;
+    const DecodeConfig config{&select_decoder(options.isa), options.strict,
+                              options.filter.is_active() ? &options.filter : nullptr};
+
+    // -j on compressed input spreads decompression and decoding over the
+    // pipeline's threads instead of splitting the (unseekable) text
+    bool pipelined = options.pipeline;
+
+    if (!options.emit_binary.empty())
+    {
+        try
+        {
+            StreamReader stream_reader(options.file_name);
+            BinaryTraceWriter writer(options.emit_binary);
+            emit_binary(stream_reader, config, writer, counts);
 
-    size_t total_lines = file_reader.get_lines_count() + 1;
+            const std::size_t text_bytes = stream_reader.get_offset();
+            std::cerr << "records: " << counts.count << std::endl;
+            if (counts.bad_lines)
+                std::cerr << "lines without instruction: " << counts.bad_lines << std::endl;
+            std::cerr << "text bytes: " << text_bytes << ", binary bytes: " << writer.get_bytes_written();
+            if (writer.get_bytes_written())
+                std::cerr << " (" << (double)text_bytes / writer.get_bytes_written() << "x smaller)";
+            std::cerr << std::endl;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "error: " << e.what() << " (after " << counts.count << " records)" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    file_reader.open(file_name);
+    InternSummary intern_summary;
+    InstructionStats stats;
 
-    while (file_reader.get_next_line(line))
+    if (!options.export_arrow.empty())
     {
-        DecodedInstruction inst{};
-        code = extract_instruction_from_line(line);
-        inst.line = line;
-        decode_instruction(code, inst);
+        try
+        {
+            ArrowTraceWriter writer(options.export_arrow);
+            if (options.intern)
+                decode_interned(options, config, out, counts, intern_summary, stats, &writer);
+            else
+                export_arrow(options, config, writer, counts);
+
+            std::cerr << "rows: " << writer.get_row_count() << ", compressed: " << counts.count_compressed << std::endl;
+            if (counts.bad_lines)
+                std::cerr << "lines without instruction: " << counts.bad_lines << std::endl;
+            if (counts.unknown.get_total())
+                counts.unknown.report(std::cerr);
+            std::cerr << "arrow bytes: " << writer.get_bytes_written() << std::endl;
+            if (options.intern)
+                print_intern_summary(intern_summary, counts);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "error: " << e.what() << " (after " << counts.count << " rows)" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::unique_ptr<RoiScanner> roi =
+        options.roi_start.is_set() ? std::make_unique<RoiScanner>(options.roi_start, options.roi_end) : nullptr;
+    bool is_binary_input = false;
 
-        std::cout << uint32_t_to_hex(code) << " ";
-        // std::cout << inst.line << std::endl;
-        std::cout << inst.mnemonic << " ";
-        inst.print_payload();
-        std::cout << std::endl;
+    try
+    {
+        if (options.intern)
+        {
+            decode_interned(options, config, out, counts, intern_summary, stats, nullptr);
+        }
+        else if (is_stream_input(options.file_name))
+        {
+            if (options.has_range || options.build_index)
+                throw std::runtime_error("--range and --index need an uncompressed text trace file");
+            if (options.jobs > 1)
+                throw std::runtime_error("-j needs a regular file, use --pipeline to decode a stream on several threads");
 
-        if (inst.compressed)
-            count_compressed++;
-        count++;
+            if (options.pipeline && roi)
+                throw std::runtime_error("--roi with --pipeline needs an uncompressed text trace file");
 
-        if (count % 100000 == 0)
+            StreamReader stream_reader(options.file_name);
+            if (options.stats || roi)
+                decode_stream_blocks(stream_reader, options, config, roi.get(), out, counts, stats);
+            else if (options.pipeline)
+                decode_pipeline(stream_reader, config, options.decode_cache, out, counts, pipeline_stats);
+            else
+                decode_serial(stream_reader, 0, config, options.decode_cache, out, counts);
+        }
+        else
         {
-            // Show loading bar
-            float progress = (float)count / total_lines;
-            print_progress_bar(progress);
+            auto file_reader = FileReader(options.file_name, options.huge_pages);
+
+            const Compression compression = detect_compression(file_reader.get_data().substr(0, compression_magic_size));
+            std::vector<std::string_view> frames;
+            if ((options.has_range || options.build_index) &&
+                (is_binary_trace(file_reader.get_data()) || compression != Compression::NONE))
+                throw std::runtime_error("--range and --index need an uncompressed text trace file");
+
+            if (is_binary_trace(file_reader.get_data()))
+            {
+                if (options.jobs > 1 || options.pipeline)
+                    throw std::runtime_error("-j and --pipeline need a text trace, .rvtb input is decoded serially");
+                is_binary_input = true;
+                BinaryTraceReader binary_reader(file_reader.get_data());
+                if (options.stats)
+                    collect_stats_binary(binary_reader, file_reader.get_size(), config, roi.get(), stats, counts);
+                else
+                    decode_binary(binary_reader, file_reader.get_size(), config, options.decode_cache, roi.get(), out,
+                                  counts);
+            }
+            else if (compression != Compression::NONE && (options.stats || roi))
+            {
+                if (options.pipeline)
+                    throw std::runtime_error("--roi with --pipeline needs an uncompressed text trace file");
+                StreamReader stream_reader(options.file_name);
+                decode_stream_blocks(stream_reader, options, config, roi.get(), out, counts, stats);
+            }
+            else if (compression != Compression::NONE)
+            {
+                pipelined = options.pipeline || options.jobs > 1;
+                // several zstd frames decompress independently, everything
+                // else is decompressed as one stream
+                if (pipelined && compression == Compression::ZSTD && zstd_supported())
+                    frames = split_zstd_frames(file_reader.get_data());
+
+                if (frames.size() > 1)
+                {
+                    decode_pipeline(frames, options.jobs, config, options.decode_cache, out, counts, pipeline_stats);
+                }
+                else
+                {
+                    StreamReader stream_reader(options.file_name);
+                    if (pipelined)
+                        decode_pipeline(stream_reader, config, options.decode_cache, out, counts, pipeline_stats);
+                    else
+                        decode_serial(stream_reader, 0, config, options.decode_cache, out, counts);
+                }
+            }
+            else
+            {
+                decode_text_file(file_reader, options, config, roi.get(), out, counts, pipeline_stats, stats);
+            }
         }
+        out.flush();
+    }
+    catch (const std::exception &e)
+    {
+        // keep everything decoded before the failing line
+        out.flush();
+        std::cerr << std::endl;
+        std::cerr << "error: " << e.what() << " (after " << counts.count << " instructions)" << std::endl;
+        return 1;
     }
 
+    if (options.stats)
+        print_instruction_stats(stats, std::cout);
+
     std::cerr << std::endl;
-    std::cerr << "compressed: " << count_compressed << std::endl;
-    std::cerr << "all: " << count << std::endl;
+    std::cerr << "compressed: " << counts.count_compressed << std::endl;
+    std::cerr << "all: " << counts.count << std::endl;
+    if (counts.bad_lines)
+        std::cerr << "lines without instruction: " << counts.bad_lines << std::endl;
+    if (config.filter)
+        std::cerr << "filtered out: " << counts.filtered << std::endl;
+    if (roi && !roi->found())
+        std::cerr << "region of interest: start marker not found" << std::endl;
+    else if (roi)
+        std::cerr << "region of interest: fast-forwarded over " << roi->get_skipped()
+                  << (is_binary_input ? " records, " : " bytes, ")
+                  << (roi->done() ? "stopped at the end marker" : "no end marker, ran to the end") << std::endl;
+    if (counts.unknown.get_total())
+        counts.unknown.report(std::cerr);
+    if (options.intern)
+        print_intern_summary(intern_summary, counts);
+    if (pipelined)
+        print_pipeline_stats(pipeline_stats, std::cerr);
+    if (options.decode_cache)
+    {
+        std::size_t lookups = counts.cache_hits + counts.cache_misses;
+        std::cerr << "decode cache hits: " << counts.cache_hits
+                  << " misses: " << counts.cache_misses;
+        if (lookups)
+            std::cerr << " (" << 100.0 * counts.cache_hits / lookups << " %)";
+        std::cerr << std::endl;
+    }
 
     return 0;
 }
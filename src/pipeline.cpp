@@ -0,0 +1,609 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pipeline.hpp"
+#include "spsc_queue.hpp"
+#include "line_parse.hpp"
+#include "decoder.hpp"
+#include "decompress.hpp"
+
+// newline-aligned unit of the read stage
+static constexpr std::size_t block_size = 1 << 20;
+
+// lines per batch between the parse, decode and write stages
+static constexpr std::size_t pipeline_batch_size = 4096;
+
+// batches in flight; also bounds how far parsing runs ahead of writing
+static constexpr std::size_t batch_pool_size = 16;
+
+// block buffers in flight when reading a stream
+static constexpr std::size_t stream_buffer_count = 8;
+
+// zstd frames decompressed ahead of the read stage, per worker
+static constexpr std::size_t frames_per_worker = 2;
+
+static constexpr std::size_t max_zstd_workers = 16;
+
+// free space in front of a decompressed frame for the partial line the
+// previous frame ended with
+static constexpr std::size_t frame_headroom = 4096;
+
+static constexpr std::size_t page_size = 4096;
+
+struct Block
+{
+    std::string_view text;
+    // input offset of text
+    std::size_t offset = 0;
+    // stream input: the buffer holding text, recycled once written
+    std::string *buffer = nullptr;
+    bool last = false;
+};
+
+static Block end_of_input()
+{
+    Block block;
+    block.last = true;
+    return block;
+}
+
+struct LineBatch
+{
+    std::size_t count = 0;
+    // offset just past the last line, for progress
+    std::size_t end_offset = 0;
+    // strict mode: the batch ends at this unparsable line
+    bool has_bad_line = false;
+    std::string_view bad_line;
+    // stream input: the last batch of a block returns its buffer
+    std::string *release_buffer = nullptr;
+    std::array<std::string_view, pipeline_batch_size> lines;
+    std::array<uint32_t, pipeline_batch_size> codes;
+    std::array<DecodedInstruction, pipeline_batch_size> insts;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+static double seconds_since(clock_type::time_point start)
+{
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// Shared state of one decode_pipeline run. A null batch pointer ends the
+// stream on the batch queues, a Block with last set on the block queue.
+struct Pipeline
+{
+    SpscQueue<Block, 64> blocks;
+    SpscQueue<LineBatch *, batch_pool_size> parsed;
+    SpscQueue<LineBatch *, batch_pool_size> decoded;
+    // written batches travel back to the parser for reuse
+    SpscQueue<LineBatch *, batch_pool_size> free;
+    // and written stream buffers back to the reader
+    SpscQueue<std::string *, 64> free_buffers;
+    std::atomic<bool> stop{false};
+
+    // Retries op until it succeeds; false if the pipeline was stopped while
+    // waiting. The time spent waiting is added to stage.wait_seconds.
+    template <typename Op>
+    bool wait_for(Op op, StageStats &stage)
+    {
+        if (op())
+            return true;
+        const clock_type::time_point start = clock_type::now();
+        for (unsigned spins = 0; !op(); spins++)
+        {
+            if (stop.load(std::memory_order_relaxed))
+                return false;
+            if (spins >= 64)
+                std::this_thread::yield();
+        }
+        stage.wait_seconds += seconds_since(start);
+        return true;
+    }
+};
+
+static bool push_block(const Block &block, Pipeline &pipeline, StageStats &stats)
+{
+    return pipeline.wait_for([&]
+                             { return pipeline.blocks.try_push(block); }, stats);
+}
+
+static void read_mapped_stage(std::string_view data, Pipeline &pipeline, StageStats &stats)
+{
+    std::size_t pos = 0;
+    while (pos < data.size())
+    {
+        std::size_t end = std::min(pos + block_size, data.size());
+        if (end < data.size())
+        {
+            std::size_t eol = data.find('\n', end - 1);
+            end = eol == std::string_view::npos ? data.size() : eol + 1;
+        }
+
+        // fault the block in here so the parser finds it resident
+        volatile char sink = 0;
+        for (std::size_t page = pos; page < end; page += page_size)
+            sink = sink + data[page];
+
+        if (!push_block(Block{data.substr(pos, end - pos), pos}, pipeline, stats))
+            return;
+        stats.items += end - pos;
+        pos = end;
+    }
+    push_block(end_of_input(), pipeline, stats);
+}
+
+static void read_stream_stage(StreamReader &reader, Pipeline &pipeline, StageStats &stats)
+{
+    std::size_t offset = 0;
+    for (;;)
+    {
+        std::string *buffer;
+        if (!pipeline.wait_for([&]
+                               { return pipeline.free_buffers.try_pop(buffer); }, stats))
+            return;
+
+        // time blocked in read(2) is waiting for the producer, not work
+        const clock_type::time_point start = clock_type::now();
+        bool more = reader.read_block(*buffer);
+        stats.wait_seconds += seconds_since(start);
+        if (!more)
+            break;
+
+        if (!push_block(Block{*buffer, offset, buffer}, pipeline, stats))
+            return;
+        stats.items += buffer->size();
+        offset += buffer->size();
+    }
+    push_block(end_of_input(), pipeline, stats);
+}
+
+static constexpr std::size_t no_frame = SIZE_MAX;
+
+// Hand-over point between the read stage and the zstd workers. Frame i uses
+// slot i % slots.size(): the read stage stores the buffer and publishes i
+// in assigned, the worker decompresses into it and publishes i in done.
+struct FrameSlot
+{
+    std::atomic<std::size_t> assigned{no_frame};
+    std::atomic<std::size_t> done{no_frame};
+    std::string *buffer = nullptr;
+    std::exception_ptr error;
+};
+
+static void zstd_worker(const std::vector<std::string_view> &frames, std::vector<FrameSlot> &slots,
+                        std::atomic<std::size_t> &next_frame, Pipeline &pipeline, StageStats &stats)
+{
+    for (;;)
+    {
+        // frames are claimed in order, so the read stage never waits on a
+        // frame nobody works on
+        const std::size_t i = next_frame.fetch_add(1);
+        if (i >= frames.size())
+            return;
+
+        FrameSlot &slot = slots[i % slots.size()];
+        if (!pipeline.wait_for([&]
+                               { return slot.assigned.load(std::memory_order_acquire) == i; }, stats))
+            return;
+
+        const clock_type::time_point start = clock_type::now();
+        try
+        {
+            decompress_zstd_frame(frames[i], *slot.buffer, frame_headroom);
+            stats.items += slot.buffer->size() - frame_headroom;
+        }
+        catch (...)
+        {
+            slot.error = std::current_exception();
+        }
+        stats.busy_seconds += seconds_since(start);
+        slot.done.store(i, std::memory_order_release);
+    }
+}
+
+static void feed_zstd_frames(const std::vector<std::string_view> &frames, std::vector<FrameSlot> &slots,
+                             Pipeline &pipeline, StageStats &stats)
+{
+    // a frame without a complete line gives its buffer straight back
+    std::string *spare = nullptr;
+    auto take_buffer = [&](std::string *&buffer)
+    {
+        buffer = spare;
+        spare = nullptr;
+        return buffer || pipeline.wait_for([&]
+                                           { return pipeline.free_buffers.try_pop(buffer); }, stats);
+    };
+
+    std::string carry;
+    std::size_t offset = 0;
+    std::size_t assigned = 0;
+    for (std::size_t i = 0; i < frames.size(); i++)
+    {
+        for (; assigned < frames.size() && assigned < i + slots.size(); assigned++)
+        {
+            FrameSlot &slot = slots[assigned % slots.size()];
+            if (!take_buffer(slot.buffer))
+                return;
+            slot.assigned.store(assigned, std::memory_order_release);
+        }
+
+        FrameSlot &slot = slots[i % slots.size()];
+        if (!pipeline.wait_for([&]
+                               { return slot.done.load(std::memory_order_acquire) == i; }, stats))
+            return;
+        if (slot.error)
+            std::rethrow_exception(slot.error);
+
+        // put the end of the previous frame's last line in front
+        std::string &buffer = *slot.buffer;
+        std::size_t begin = frame_headroom;
+        if (carry.size() <= frame_headroom)
+        {
+            begin -= carry.size();
+            memcpy(buffer.data() + begin, carry.data(), carry.size());
+        }
+        else
+        {
+            buffer.replace(0, frame_headroom, carry);
+            begin = 0;
+        }
+
+        std::string_view text = std::string_view(buffer).substr(begin);
+        carry.clear();
+        if (i + 1 < frames.size())
+        {
+            const std::size_t last = text.rfind('\n');
+            const std::size_t keep = last == std::string_view::npos ? 0 : last + 1;
+            carry.assign(text.substr(keep));
+            text = text.substr(0, keep);
+        }
+
+        if (text.empty())
+        {
+            spare = &buffer;
+            continue;
+        }
+        if (!push_block(Block{text, offset, &buffer}, pipeline, stats))
+            return;
+        stats.items += text.size();
+        offset += text.size();
+    }
+    push_block(end_of_input(), pipeline, stats);
+}
+
+static void read_zstd_stage(const std::vector<std::string_view> &frames, std::size_t threads, Pipeline &pipeline,
+                            StageStats &stats, StageStats &decompress_stats)
+{
+    std::vector<FrameSlot> slots(threads * frames_per_worker);
+    std::vector<StageStats> worker_stats(threads);
+    std::atomic<std::size_t> next_frame{0};
+
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; t++)
+        workers.emplace_back([&, t]
+                             { zstd_worker(frames, slots, next_frame, pipeline, worker_stats[t]); });
+
+    auto join_workers = [&]
+    {
+        for (std::thread &worker : workers)
+            worker.join();
+        for (const StageStats &worker : worker_stats)
+        {
+            decompress_stats.items += worker.items;
+            decompress_stats.busy_seconds += worker.busy_seconds;
+            decompress_stats.wait_seconds += worker.wait_seconds;
+        }
+    };
+
+    try
+    {
+        feed_zstd_frames(frames, slots, pipeline, stats);
+    }
+    catch (...)
+    {
+        // workers waiting for a frame give up once the pipeline stops
+        pipeline.stop = true;
+        join_workers();
+        throw;
+    }
+    join_workers();
+}
+
+static void parse_stage(const DecodeConfig &config, Pipeline &pipeline, StageStats &stats, std::size_t &bad_lines)
+{
+    LineBatch *batch = nullptr;
+
+    auto next_batch = [&]()
+    {
+        if (batch)
+            return true;
+        if (!pipeline.wait_for([&]
+                               { return pipeline.free.try_pop(batch); }, stats))
+            return false;
+        batch->count = 0;
+        batch->has_bad_line = false;
+        batch->release_buffer = nullptr;
+        return true;
+    };
+
+    auto push_batch = [&]()
+    {
+        if (!batch)
+            return true;
+        LineBatch *full = batch;
+        batch = nullptr;
+        return pipeline.wait_for([&]
+                                 { return pipeline.parsed.try_push(full); }, stats);
+    };
+
+    for (;;)
+    {
+        Block block;
+        if (!pipeline.wait_for([&]
+                               { return pipeline.blocks.try_pop(block); }, stats))
+            return;
+        if (block.last)
+            break;
+
+        std::string_view text = block.text;
+        while (!text.empty())
+        {
+            if (!next_batch())
+                return;
+
+            std::size_t eol = text.find('\n');
+            std::string_view line = text.substr(0, eol);
+            text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+            batch->end_offset = block.offset + (text.data() - block.text.data());
+
+            uint32_t code;
+            if (!try_extract_instruction_from_line(line, code))
+            {
+                if (!config.strict)
+                {
+                    bad_lines++;
+                    continue;
+                }
+                // nothing after the bad line is parsed in strict mode
+                batch->has_bad_line = true;
+                batch->bad_line = line;
+                push_batch();
+                pipeline.wait_for([&]
+                                  { return pipeline.parsed.try_push(nullptr); }, stats);
+                return;
+            }
+
+            batch->lines[batch->count] = line;
+            batch->codes[batch->count] = code;
+            batch->count++;
+            stats.items++;
+            if (batch->count == pipeline_batch_size && !push_batch())
+                return;
+        }
+
+        // lines of a stream block must be written before its buffer is
+        // reused, so its last batch carries the buffer back
+        if (block.buffer)
+        {
+            if (!next_batch())
+                return;
+            batch->release_buffer = block.buffer;
+            if (!push_batch())
+                return;
+        }
+    }
+
+    if (push_batch())
+        pipeline.wait_for([&]
+                          { return pipeline.parsed.try_push(nullptr); }, stats);
+}
+
+static void decode_stage(const DecodeConfig &config, bool use_cache, Pipeline &pipeline, StageStats &stats,
+                         DecodeCounts &cache_counts)
+{
+    std::unique_ptr<DecodeCache> cache = use_cache ? std::make_unique<DecodeCache>(*config.decoder) : nullptr;
+
+    for (;;)
+    {
+        LineBatch *batch;
+        if (!pipeline.wait_for([&]
+                               { return pipeline.parsed.try_pop(batch); }, stats))
+            break;
+
+        if (batch)
+        {
+            const std::span<const uint32_t> codes(batch->codes.data(), batch->count);
+            if (cache)
+            {
+                for (std::size_t i = 0; i < batch->count; i++)
+                {
+                    batch->insts[i] = DecodedInstruction{};
+                    cache->decode(codes[i], batch->insts[i]);
+                }
+            }
+            else
+            {
+                config.decoder->decode_batch(codes, batch->insts);
+            }
+            stats.items += batch->count;
+        }
+
+        if (!pipeline.wait_for([&]
+                               { return pipeline.decoded.try_push(batch); }, stats) ||
+            !batch)
+            break;
+    }
+
+    if (cache)
+    {
+        cache_counts.cache_hits = cache->get_hits();
+        cache_counts.cache_misses = cache->get_misses();
+    }
+}
+
+static void write_stage(const DecodeConfig &config, Pipeline &pipeline, OutputBuffer &out, DecodeCounts &counts,
+                        const progress_callback_t &progress, StageStats &stats)
+{
+    for (;;)
+    {
+        LineBatch *batch;
+        if (!pipeline.wait_for([&]
+                               { return pipeline.decoded.try_pop(batch); }, stats) ||
+            !batch)
+            return;
+
+        for (std::size_t i = 0; i < batch->count; i++)
+        {
+            const DecodedInstruction &inst = batch->insts[i];
+            if (!inst.is_known())
+            {
+                if (config.strict)
+                    fail_line(DecodeStatus::UNKNOWN_ENCODING, batch->codes[i], batch->lines[i]);
+                counts.unknown.record(batch->codes[i]);
+            }
+            print_listing_line(inst, out, counts);
+        }
+        stats.items += batch->count;
+
+        if (batch->has_bad_line)
+            fail_line(DecodeStatus::NO_INSTRUCTION, 0, batch->bad_line);
+        if (progress)
+            progress(batch->end_offset);
+
+        // the pools have room for every batch and buffer, so these never wait
+        if (batch->release_buffer)
+            pipeline.free_buffers.try_push(batch->release_buffer);
+        pipeline.free.try_push(batch);
+    }
+}
+
+// Runs fn and records its wall time minus queue waits as busy time.
+template <typename Fn>
+static void run_stage(Fn fn, StageStats &stats, Pipeline &pipeline, std::exception_ptr &error)
+{
+    const clock_type::time_point start = clock_type::now();
+    try
+    {
+        fn();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+        pipeline.stop = true;
+    }
+    stats.busy_seconds = seconds_since(start) - stats.wait_seconds;
+}
+
+template <typename ReadStage>
+static void run_pipeline(ReadStage read_stage, Pipeline &pipeline, const DecodeConfig &config, bool use_cache,
+                         OutputBuffer &out, DecodeCounts &counts, const progress_callback_t &progress,
+                         PipelineStats &stats)
+{
+    std::vector<std::unique_ptr<LineBatch>> pool;
+    for (std::size_t i = 0; i < batch_pool_size; i++)
+    {
+        pool.push_back(std::make_unique<LineBatch>());
+        pipeline.free.try_push(pool.back().get());
+    }
+
+    std::size_t bad_lines = 0;
+    DecodeCounts cache_counts;
+    std::array<std::exception_ptr, 4> errors;
+
+    std::thread reader([&]
+                       { run_stage([&]
+                                   { read_stage(stats.read); }, stats.read, pipeline, errors[0]); });
+    std::thread parser([&]
+                       { run_stage([&]
+                                   { parse_stage(config, pipeline, stats.parse, bad_lines); },
+                                   stats.parse, pipeline, errors[1]); });
+    std::thread decoder([&]
+                        { run_stage([&]
+                                    { decode_stage(config, use_cache, pipeline, stats.decode, cache_counts); },
+                                    stats.decode, pipeline, errors[2]); });
+    // the writer runs on the calling thread, which owns out
+    run_stage([&]
+              { write_stage(config, pipeline, out, counts, progress, stats.write); },
+              stats.write, pipeline, errors[3]);
+    // a writer that stopped early must release the stages blocked behind it
+    pipeline.stop = true;
+
+    reader.join();
+    parser.join();
+    decoder.join();
+
+    counts.bad_lines += bad_lines;
+    counts.cache_hits += cache_counts.cache_hits;
+    counts.cache_misses += cache_counts.cache_misses;
+
+    for (const std::exception_ptr &error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+void decode_pipeline(std::string_view data, const DecodeConfig &config, bool use_cache, OutputBuffer &out,
+                     DecodeCounts &counts, const progress_callback_t &progress, PipelineStats &stats)
+{
+    auto pipeline = std::make_unique<Pipeline>();
+    run_pipeline([&](StageStats &read_stats)
+                 { read_mapped_stage(data, *pipeline, read_stats); },
+                 *pipeline, config, use_cache, out, counts, progress, stats);
+}
+
+void decode_pipeline(StreamReader &reader, const DecodeConfig &config, bool use_cache, OutputBuffer &out,
+                     DecodeCounts &counts, PipelineStats &stats)
+{
+    auto pipeline = std::make_unique<Pipeline>();
+    std::array<std::string, stream_buffer_count> buffers;
+    for (std::string &buffer : buffers)
+        pipeline->free_buffers.try_push(&buffer);
+
+    run_pipeline([&](StageStats &read_stats)
+                 { read_stream_stage(reader, *pipeline, read_stats); },
+                 *pipeline, config, use_cache, out, counts, nullptr, stats);
+}
+
+void decode_pipeline(const std::vector<std::string_view> &frames, std::size_t threads, const DecodeConfig &config,
+                     bool use_cache, OutputBuffer &out, DecodeCounts &counts, PipelineStats &stats)
+{
+    threads = std::clamp<std::size_t>(threads, 1, max_zstd_workers);
+
+    // every slot holds a buffer, and the stages after the reader keep some
+    // busy as well
+    auto pipeline = std::make_unique<Pipeline>();
+    std::vector<std::string> buffers(threads * frames_per_worker + stream_buffer_count);
+    for (std::string &buffer : buffers)
+        pipeline->free_buffers.try_push(&buffer);
+
+    run_pipeline([&](StageStats &read_stats)
+                 { read_zstd_stage(frames, threads, *pipeline, read_stats, stats.decompress); },
+                 *pipeline, config, use_cache, out, counts, nullptr, stats);
+}
+
+void print_pipeline_stats(const PipelineStats &stats, std::ostream &os)
+{
+    for (const StageStats *stage : {&stats.decompress, &stats.read, &stats.parse, &stats.decode, &stats.write})
+    {
+        if (stage == &stats.decompress && !stage->items)
+            continue;
+        os << "stage " << std::left << std::setw(11) << stage->name << std::right << stage->items << " "
+           << stage->unit << ", busy " << std::fixed << std::setprecision(3) << stage->busy_seconds
+           << " s, waiting " << stage->wait_seconds << " s";
+        if (stage->busy_seconds >= 1e-3)
+            os << " (" << std::setprecision(1) << stage->items / stage->busy_seconds / 1e6 << " M " << stage->unit
+               << "/s)";
+        os << std::defaultfloat << std::setprecision(6) << "\n";
+    }
+}
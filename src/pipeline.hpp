@@ -0,0 +1,62 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "chunk_decoder.hpp"
+#include "output.hpp"
+#include "reader.hpp"
+
+// Work and idle time of one pipeline stage. busy_seconds excludes the time
+// spent waiting on the neighbouring queues, so the stage with the highest
+// busy time is the bottleneck.
+struct StageStats
+{
+    const char *name = "";
+    const char *unit = "";
+    uint64_t items = 0;
+    double busy_seconds = 0;
+    double wait_seconds = 0;
+};
+
+struct PipelineStats
+{
+    StageStats read{"read", "bytes"};
+    StageStats parse{"parse", "lines"};
+    StageStats decode{"decode", "instructions"};
+    StageStats write{"write", "lines"};
+    // zstd worker threads, summed; only used for frame-parallel input
+    StageStats decompress{"decompress", "bytes"};
+};
+
+// Decodes data on four threads connected by lock-free SPSC queues:
+//   read   touches the mapped pages of the next blocks so disk reads overlap
+//          with the CPU stages,
+//   parse  splits blocks into lines and extracts instruction words,
+//   decode decodes batches of words,
+//   write  formats the listing in line order.
+// Full queues block the stage before them, so memory stays bounded. The
+// output is identical to calling decode_line on every line in turn.
+void decode_pipeline(std::string_view data, const DecodeConfig &config, bool use_cache, OutputBuffer &out,
+                     DecodeCounts &counts, const progress_callback_t &progress, PipelineStats &stats);
+
+// Same for a pipe or FIFO: the read stage fills a fixed set of block
+// buffers with read(2), and a buffer is reused once all its lines are
+// written. Time blocked in read(2) counts as waiting.
+void decode_pipeline(StreamReader &reader, const DecodeConfig &config, bool use_cache, OutputBuffer &out,
+                     DecodeCounts &counts, PipelineStats &stats);
+
+// Same for the frames of a zstd file (see split_zstd_frames): threads
+// workers decompress up to two frames each ahead of the one the read stage
+// passes on, and lines split across a frame boundary are joined again
+// before parsing. Nothing decompressed goes to disk.
+void decode_pipeline(const std::vector<std::string_view> &frames, std::size_t threads, const DecodeConfig &config,
+                     bool use_cache, OutputBuffer &out, DecodeCounts &counts, PipelineStats &stats);
+
+void print_pipeline_stats(const PipelineStats &stats, std::ostream &os);
+
+#endif
@@ -1,10 +1,19 @@
+#include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "reader.hpp"
 
-FileReader::FileReader(const std::string &ifile_name)
+FileReader::FileReader(const std::string &ifile_name, bool huge_pages)
 {
-    open(ifile_name);
+    open(ifile_name, huge_pages);
 }
 
 FileReader::~FileReader()
@@ -12,62 +21,217 @@ FileReader::~FileReader()
     close();
 }
 
-void FileReader::open(const std::string &ifile_name)
+void FileReader::open(const std::string &ifile_name, bool huge_pages)
 {
-    if (m_ifile.is_open())
+    close();
+
+    m_fd = ::open(ifile_name.c_str(), O_RDONLY);
+    if (m_fd < 0)
     {
-        m_ifile.close();
+        throw std::runtime_error("Could not open file: " + ifile_name);
     }
-    m_ifile.open(ifile_name);
-    if (!m_ifile.is_open())
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0)
     {
-        throw std::runtime_error("Could not open file: " + ifile_name);
+        close();
+        throw std::runtime_error("Could not stat file: " + ifile_name);
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    // mmap rejects zero-length mappings, an empty trace simply has no lines
+    if (m_size == 0)
+    {
+        return;
+    }
+
+    void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close();
+        throw std::runtime_error("Could not map file: " + ifile_name);
     }
+    m_data = static_cast<const char *>(data);
+
+    // the trace is consumed front to back exactly once
+    madvise(data, m_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    // only honoured where the kernel supports huge pages for file mappings
+    if (huge_pages)
+    {
+        madvise(data, m_size, MADV_HUGEPAGE);
+    }
+#else
+    (void)huge_pages;
+#endif
 }
 
 void FileReader::close()
 {
-    if (m_ifile.is_open())
+    if (m_data)
     {
-        m_ifile.close();
+        munmap(const_cast<char *>(m_data), m_size);
+        m_data = nullptr;
     }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+    m_pos = 0;
 }
 
-bool FileReader::get_next_line(std::string &line)
+bool FileReader::get_next_line(std::string_view &line)
 {
-    if (!m_ifile.is_open())
+    if (m_fd < 0)
     {
         throw std::runtime_error("Could not read file");
     }
 
-    if (std::getline(m_ifile, line))
+    if (m_pos >= m_size)
     {
-        return true;
+        return false;
+    }
+
+    const char *begin = m_data + m_pos;
+    const char *end = static_cast<const char *>(memchr(begin, '\n', m_size - m_pos));
+    if (end)
+    {
+        line = std::string_view(begin, end - begin);
+        m_pos += line.size() + 1;
+    }
+    else
+    {
+        // last line without a trailing newline
+        line = std::string_view(begin, m_size - m_pos);
+        m_pos = m_size;
+    }
+    return true;
+}
+
+StreamReader::StreamReader(const std::string &ifile_name, std::size_t block_size)
+    : m_block_size(block_size)
+{
+    if (ifile_name == "-")
+    {
+        m_fd = STDIN_FILENO;
+    }
+    else
+    {
+        m_fd = ::open(ifile_name.c_str(), O_RDONLY);
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Could not open file: " + ifile_name);
+        }
+        m_owns_fd = true;
+    }
+
+    try
+    {
+        m_source = open_byte_source(m_fd);
+    }
+    catch (...)
+    {
+        if (m_owns_fd)
+        {
+            ::close(m_fd);
+        }
+        throw;
     }
-    return false;
 }
 
-std::size_t FileReader::get_lines_count()
+StreamReader::~StreamReader()
 {
-    if (!m_ifile.is_open())
+    if (m_owns_fd)
     {
-        throw std::runtime_error("File is not open");
+        ::close(m_fd);
     }
+}
 
-    std::streampos curr_pos = m_ifile.tellg();
-    m_ifile.clear();
+bool StreamReader::read_block(std::string &block)
+{
+    block.assign(m_carry);
+    m_carry.clear();
+
+    for (;;)
+    {
+        if (block.size() >= m_block_size || (m_eof && !block.empty()))
+        {
+            std::size_t last = block.rfind('\n');
+            if (last != std::string::npos)
+            {
+                m_carry.assign(block, last + 1);
+                block.resize(last + 1);
+                break;
+            }
+            if (m_eof)
+            {
+                // unterminated last line
+                break;
+            }
+        }
+        if (m_eof)
+        {
+            break;
+        }
 
-    m_ifile.seekg(0, std::ios::beg);
+        const std::size_t old_size = block.size();
+        const std::size_t want = std::max(m_block_size - std::min(old_size, m_block_size), std::size_t(64) << 10);
+        std::size_t count = 0;
+        std::exception_ptr error;
+        // the callback must not throw, so read errors are rethrown after it
+        block.resize_and_overwrite(old_size + want, [&](char *data, std::size_t)
+                                   {
+                                       try
+                                       {
+                                           count = m_source->read(data + old_size, want);
+                                       }
+                                       catch (...)
+                                       {
+                                           error = std::current_exception();
+                                       }
+                                       return old_size + count; });
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if (count == 0)
+        {
+            m_eof = true;
+        }
+    }
+
+    m_offset += block.size();
+    return !block.empty();
+}
 
-    std::size_t line_count = 0;
-    std::string tmp;
-    while (std::getline(m_ifile, tmp))
+bool StreamReader::get_next_line(std::string_view &line)
+{
+    while (m_pos >= m_block.size())
     {
-        ++line_count;
+        if (!read_block(m_block))
+        {
+            m_pos = 0;
+            return false;
+        }
+        m_pos = 0;
     }
 
-    m_ifile.clear();
-    m_ifile.seekg(curr_pos);
+    std::string_view rest = std::string_view(m_block).substr(m_pos);
+    std::size_t eol = rest.find('\n');
+    line = rest.substr(0, eol);
+    m_pos += eol == std::string_view::npos ? rest.size() : eol + 1;
+    return true;
+}
 
-    return line_count;
+bool is_stream_input(const std::string &file_name)
+{
+    if (file_name == "-")
+    {
+        return true;
+    }
+    struct stat st;
+    // let FileReader report missing files
+    return stat(file_name.c_str(), &st) == 0 && !S_ISREG(st.st_mode);
 }
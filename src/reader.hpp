@@ -1,25 +1,91 @@
 #ifndef FILE_READER_HPP
 #define FILE_READER_HPP
 
-#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cstddef>
 
+#include "decompress.hpp"
+
+// Reads a trace through a read-only memory mapping of the whole file.
+// Lines are handed out as views into the mapping, so they stay valid
+// until the reader is closed or reopened.
 class FileReader
 {
 private:
-    std::ifstream m_ifile;
+    int m_fd = -1;
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    std::size_t m_pos = 0;
 
 public:
-    FileReader(const std::string &ifile_name);
+    FileReader(const std::string &ifile_name, bool huge_pages = false);
 
     ~FileReader();
 
-    void open(const std::string &ifile_name);
+    FileReader(const FileReader &) = delete;
+    FileReader &operator=(const FileReader &) = delete;
+
+    void open(const std::string &ifile_name, bool huge_pages = false);
 
     void close();
 
-    bool get_next_line(std::string &line);
+    bool get_next_line(std::string_view &line);
+
+    // byte position of the next unread line, used for progress reporting
+    std::size_t get_offset() const { return m_pos; }
 
-    std::size_t get_lines_count();
+    std::size_t get_size() const { return m_size; }
+
+    // the whole mapped trace, for callers that split it up themselves
+    std::string_view get_data() const { return std::string_view(m_data, m_size); }
 };
 
-#endif
\ No newline at end of file
+// Reads a trace from a pipe, FIFO or terminal with read(2), so spike can
+// write into the parser directly instead of into a trace file. Memory is
+// bounded by the block size plus the longest line. "-" is standard input.
+// gzip, xz and zstd input is recognised by its magic number and
+// decompressed on the fly, from a pipe as well as from a file.
+class StreamReader
+{
+private:
+    int m_fd = -1;
+    bool m_owns_fd = false;
+    std::unique_ptr<ByteSource> m_source;
+    bool m_eof = false;
+    std::size_t m_block_size;
+    // start of a line split by the end of the previous block
+    std::string m_carry;
+    // block get_next_line hands out lines from
+    std::string m_block;
+    std::size_t m_pos = 0;
+    std::size_t m_offset = 0;
+
+public:
+    static constexpr std::size_t default_block_size = 1 << 20;
+
+    explicit StreamReader(const std::string &ifile_name, std::size_t block_size = default_block_size);
+
+    ~StreamReader();
+
+    StreamReader(const StreamReader &) = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+
+    // Replaces block with the next run of whole lines: at least the block
+    // size unless the input ends first, and always ending in '\n' except for
+    // an unterminated last line. Returns false once the input is exhausted.
+    bool read_block(std::string &block);
+
+    // Lines stay valid until the next call.
+    bool get_next_line(std::string_view &line);
+
+    // bytes handed out so far
+    std::size_t get_offset() const { return m_offset - (m_block.size() - m_pos); }
+};
+
+// True for "-" and for anything that is not a regular file (FIFOs, pipes
+// under /dev/fd, character devices), which cannot be memory mapped.
+bool is_stream_input(const std::string &file_name);
+
+#endif
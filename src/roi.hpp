@@ -0,0 +1,78 @@
+#ifndef ROI_HPP
+#define ROI_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+// A trace line that opens or closes the region of interest.
+struct RoiMarker
+{
+    enum class Kind : uint8_t
+    {
+        NONE,
+        // a magic instruction word
+        WORD,
+        PC,
+        // CSRRS reading cycle or instret (rdcycle/rdinstret), as benchmarks
+        // do right around the code they time
+        COUNTER_READ,
+    };
+
+    Kind kind = Kind::NONE;
+    uint64_t value = 0;
+
+    bool is_set() const { return kind != Kind::NONE; }
+
+    bool matches(std::string_view line) const;
+
+    bool matches(uint32_t code, uint64_t pc) const;
+};
+
+// "word:0x<hex>", "pc:0x<hex>" or "counter"
+RoiMarker parse_roi_marker(std::string_view text);
+
+// Cuts the region of interest out of a trace handed over in order, in
+// newline-aligned blocks. Until the start marker appears the blocks are
+// only scanned for a short byte string derived from the marker, and just
+// the line around a hit is parsed to confirm it; nothing is decoded. The
+// region runs from the start marker line to the next end marker line,
+// both included. After that done() is set and the caller can stop
+// reading.
+class RoiScanner
+{
+private:
+    RoiMarker m_start;
+    RoiMarker m_end;
+    std::string m_start_needle;
+    std::string m_end_needle;
+    bool m_inside = false;
+    bool m_done = false;
+    uint64_t m_skipped = 0;
+
+public:
+    // end may be unset to close the region at the next start marker
+    RoiScanner(const RoiMarker &start, const RoiMarker &end);
+
+    // the part of block inside the region, possibly empty
+    std::string_view clip(std::string_view block);
+
+    // Same for records that are already split up (.rvtb blocks): the region
+    // part is [begin, end).
+    void clip_records(std::span<const uint32_t> codes, std::span<const uint64_t> pcs, std::size_t &begin,
+                      std::size_t &end);
+
+    // the start marker was found
+    bool found() const { return m_inside; }
+
+    // the end marker was passed
+    bool done() const { return m_done; }
+
+    // bytes of text, or records of a .rvtb file, fast-forwarded over before
+    // the start marker
+    uint64_t get_skipped() const { return m_skipped; }
+};
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Head and tail live on separate cache lines, and each side keeps a cached
+// copy of the other's index so the shared line is only read when the queue
+// looks full (producer) or empty (consumer).
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+private:
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    static constexpr std::size_t cache_line = 64;
+
+    alignas(cache_line) std::atomic<std::size_t> m_head{0};
+    std::size_t m_cached_tail = 0;
+
+    alignas(cache_line) std::atomic<std::size_t> m_tail{0};
+    std::size_t m_cached_head = 0;
+
+    alignas(cache_line) std::array<T, Capacity> m_slots{};
+
+public:
+    // producer side; false when the queue is full
+    bool try_push(const T &value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == Capacity)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == Capacity)
+                return false;
+        }
+        m_slots[tail & (Capacity - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false when the queue is empty
+    bool try_pop(T &value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+                return false;
+        }
+        value = m_slots[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "trace_index.hpp"
+#include "line_parse.hpp"
+#include "output.hpp"
+#include "reader.hpp"
+
+static constexpr char index_magic[4] = {'R', 'V', 'T', 'I'};
+static constexpr uint16_t index_version = 1;
+static constexpr std::size_t index_header_size = 48;
+static constexpr std::size_t index_entry_size = 24;
+
+static void put_u64(std::string &out, uint64_t value)
+{
+    for (int shift = 0; shift < 64; shift += 8)
+        out.push_back(static_cast<char>(value >> shift));
+}
+
+static uint64_t get_u64(const char *data)
+{
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+        value = (value << 8) | static_cast<unsigned char>(data[i]);
+    return value;
+}
+
+// Moves offset past the next n newlines. Whole windows are only counted,
+// which vectorises, and memchr finds the exact line in the last one. On
+// return n holds the newlines that were missing before the end of data.
+static std::size_t skip_lines(std::string_view data, std::size_t offset, uint64_t &n)
+{
+    constexpr std::size_t window = 1 << 16;
+    while (n && offset < data.size())
+    {
+        const std::size_t size = std::min(window, data.size() - offset);
+        const char *begin = data.data() + offset;
+        const uint64_t newlines = std::count(begin, begin + size, '\n');
+        if (newlines < n)
+        {
+            n -= newlines;
+            offset += size;
+            continue;
+        }
+        for (; n; n--)
+        {
+            const char *eol = static_cast<const char *>(memchr(data.data() + offset, '\n', data.size() - offset));
+            offset = eol - data.data() + 1;
+        }
+    }
+    return offset;
+}
+
+static bool stat_trace(const std::string &trace_name, uint64_t &size, int64_t &mtime_ns)
+{
+    struct stat st;
+    if (stat(trace_name.c_str(), &st) != 0)
+        return false;
+    size = static_cast<uint64_t>(st.st_size);
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+std::string_view TraceIndex::slice(std::string_view data, uint64_t first, uint64_t last) const
+{
+    last = std::min(last, line_count);
+    if (first >= last || entries.empty())
+        return data.substr(data.size());
+
+    // last checkpoint at or before first
+    auto entry = std::upper_bound(entries.begin(), entries.end(), first, [](uint64_t line, const TraceIndexEntry &e)
+                                  { return line < e.line; });
+    --entry;
+
+    uint64_t skip = first - entry->line;
+    const std::size_t begin = skip_lines(data, entry->offset, skip);
+    uint64_t count = last - first;
+    const std::size_t end = skip_lines(data, begin, count);
+    return data.substr(begin, end - begin);
+}
+
+TraceIndex build_trace_index(const std::string &trace_name, std::string_view data, uint32_t interval)
+{
+    TraceIndex index;
+    index.interval = std::max<uint32_t>(interval, 1);
+    stat_trace(trace_name, index.trace_size, index.trace_mtime_ns);
+
+    std::size_t offset = 0;
+    uint64_t line = 0;
+    TraceRecord record;
+    while (offset < data.size())
+    {
+        std::string_view text = data.substr(offset);
+        text = text.substr(0, text.find('\n'));
+        index.entries.push_back(TraceIndexEntry{offset, line, parse_trace_record(text, record) ? record.pc : 0});
+
+        uint64_t missing = index.interval;
+        offset = skip_lines(data, offset, missing);
+        line += index.interval - missing;
+    }
+    // an unterminated last line counts as well
+    if (!data.empty() && data.back() != '\n')
+        line++;
+    index.line_count = line;
+    return index;
+}
+
+std::string trace_index_path(const std::string &trace_name)
+{
+    return trace_name + ".idx";
+}
+
+bool load_trace_index(const std::string &trace_name, TraceIndex &index)
+{
+    uint64_t size;
+    int64_t mtime_ns;
+    if (!stat_trace(trace_name, size, mtime_ns))
+        return false;
+
+    std::string_view data;
+    std::unique_ptr<FileReader> file;
+    try
+    {
+        file = std::make_unique<FileReader>(trace_index_path(trace_name));
+        data = file->get_data();
+    }
+    catch (const std::exception &)
+    {
+        return false;
+    }
+
+    if (data.size() < index_header_size || memcmp(data.data(), index_magic, sizeof(index_magic)) != 0 ||
+        (static_cast<unsigned char>(data[4]) | static_cast<unsigned char>(data[5]) << 8) != index_version)
+        return false;
+
+    const uint64_t entry_count = get_u64(data.data() + 40);
+    if ((data.size() - index_header_size) / index_entry_size < entry_count)
+        return false;
+
+    index.interval = static_cast<uint32_t>(get_u64(data.data() + 8));
+    index.trace_size = get_u64(data.data() + 16);
+    index.trace_mtime_ns = static_cast<int64_t>(get_u64(data.data() + 24));
+    index.line_count = get_u64(data.data() + 32);
+    if (index.trace_size != size || index.trace_mtime_ns != mtime_ns)
+        return false;
+
+    index.entries.resize(entry_count);
+    for (uint64_t i = 0; i < entry_count; i++)
+    {
+        const char *entry = data.data() + index_header_size + i * index_entry_size;
+        index.entries[i] = TraceIndexEntry{get_u64(entry), get_u64(entry + 8), get_u64(entry + 16)};
+    }
+    return true;
+}
+
+void save_trace_index(const std::string &trace_name, const TraceIndex &index)
+{
+    const std::string path = trace_index_path(trace_name);
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Could not create index: " + path);
+    }
+
+    // "RVTI", u16 version, u16 reserved, then u64 fields and the entries
+    std::string header(index_magic, sizeof(index_magic));
+    header.push_back(static_cast<char>(index_version));
+    header.push_back(static_cast<char>(index_version >> 8));
+    header.append(2, '\0');
+    put_u64(header, index.interval);
+    put_u64(header, index.trace_size);
+    put_u64(header, static_cast<uint64_t>(index.trace_mtime_ns));
+    put_u64(header, index.line_count);
+    put_u64(header, index.entries.size());
+
+    try
+    {
+        OutputBuffer out(fd);
+        out.write(header);
+        std::string entry;
+        for (const TraceIndexEntry &e : index.entries)
+        {
+            entry.clear();
+            put_u64(entry, e.offset);
+            put_u64(entry, e.line);
+            put_u64(entry, e.pc);
+            out.write(entry);
+        }
+        out.flush();
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
@@ -0,0 +1,52 @@
+#ifndef TRACE_INDEX_HPP
+#define TRACE_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Checkpoint of a text trace: line number `line` starts at byte `offset`
+// and executes the instruction at `pc` (0 if the line has none).
+struct TraceIndexEntry
+{
+    uint64_t offset;
+    uint64_t line;
+    uint64_t pc;
+};
+
+// Sidecar index of a text trace, stored next to it as <trace>.idx. One
+// entry every `interval` lines lets --range start decoding close to any
+// line instead of scanning from the beginning. The trace's size and
+// modification time are recorded so a changed trace invalidates the index.
+struct TraceIndex
+{
+    static constexpr uint32_t default_interval = 1 << 16;
+
+    uint32_t interval = default_interval;
+    uint64_t trace_size = 0;
+    int64_t trace_mtime_ns = 0;
+    uint64_t line_count = 0;
+    std::vector<TraceIndexEntry> entries;
+
+    // Lines [first, last) of data, the trace the index was built for; last
+    // is clamped to the end of the trace. Only the lines between the
+    // nearest checkpoint and `last` are scanned.
+    std::string_view slice(std::string_view data, uint64_t first, uint64_t last) const;
+};
+
+// Scans the mapped trace `trace_name` for line starts; this is a memchr
+// pass and much faster than decoding.
+TraceIndex build_trace_index(const std::string &trace_name, std::string_view data,
+                             uint32_t interval = TraceIndex::default_interval);
+
+std::string trace_index_path(const std::string &trace_name);
+
+// False when the sidecar is missing, unreadable or older than the trace.
+bool load_trace_index(const std::string &trace_name, TraceIndex &index);
+
+// Throws std::runtime_error if the sidecar cannot be written.
+void save_trace_index(const std::string &trace_name, const TraceIndex &index);
+
+#endif
@@ -1,11 +1,16 @@
+#include <algorithm>
+#include <charconv>
+
 #include "utils.hpp"
 
 // Convert uint32_t to hexadecimal string
 std::string uint32_t_to_hex(uint32_t value)
 {
-    std::stringstream ss;
-    ss << std::hex << std::uppercase << value;
-    return ss.str();
+    char digits[8];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value, 16);
+    std::transform(digits, end, digits, [](char c)
+                   { return c >= 'a' ? static_cast<char>(c - 'a' + 'A') : c; });
+    return std::string(digits, end);
 }
 
 // Convert uint32_t to decimal string
@@ -0,0 +1,184 @@
+// Round-trips spike lines through the .rvtb format: every record parsed
+// with parse_trace_record, written with a small block size and read back
+// with all fields must come out identical. The lines cover several cores,
+// privilege changes, loads, stores, x/f/v/CSR writes, truncated records and
+// loop bodies that exercise the per-pc value prediction.
+//
+//   make check
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "binary_trace.hpp"
+#include "line_parse.hpp"
+
+static constexpr std::size_t line_count = 5000;
+// small and odd, so the loop bodies straddle block boundaries
+static constexpr uint32_t block_records = 7;
+
+static std::vector<std::string> make_lines()
+{
+    // a loop body, revisited so most pcs have a previous execution
+    static constexpr uint32_t codes[] = {0x00113423, 0x00053283, 0x0000b7f5, 0x30029073,
+                                         0x02b50533, 0x00000000, 0x0005c5c1, 0x34102573};
+    std::vector<std::string> lines;
+    uint64_t state = 0x243f6a8885a308d3;
+    uint64_t counter = 0;
+    unsigned core = 0;
+    unsigned priv = 3;
+    char buf[512];
+    for (std::size_t i = 0; i < line_count; i++)
+    {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        const uint32_t r = static_cast<uint32_t>(state >> 32);
+        const std::size_t slot = i % std::size(codes);
+        const uint64_t pc = 0x80000000 + 0x1000 * core + 4 * slot;
+        counter += slot;
+
+        if (slot == 0 && r % 3 == 0)
+            core = (core + 1) % 4;
+        if (r % 97 == 0)
+            priv = priv == 3 ? 1 : priv == 1 ? 0 : 3;
+
+        int n = (r >> 8) % 50 == 0
+                    ? std::snprintf(buf, sizeof(buf), "core %3u: 0x%016llx (0x%08x)", core,
+                                    static_cast<unsigned long long>(pc), codes[slot])
+                    : std::snprintf(buf, sizeof(buf), "core %3u: %u 0x%016llx (0x%08x)", core, priv,
+                                    static_cast<unsigned long long>(pc), codes[slot]);
+        auto append = [&](const char *format, auto... args)
+        { n += std::snprintf(buf + n, sizeof(buf) - n, format, args...); };
+
+        const unsigned long long value = counter * 8 + (r % 5 == 0 ? state : 0);
+        const unsigned long long addr = 0x80021f00 + 8 * (counter % 64);
+        switch (slot)
+        {
+        case 0:
+            append(" mem 0x%016llx 0x%016llx", addr, value);
+            break;
+        case 1:
+            append(" x5  0x%016llx mem 0x%016llx", value, addr);
+            break;
+        case 2:
+            break;
+        case 3:
+            append(" c768_mstatus 0x%016llx", value & 0x1888);
+            break;
+        case 4:
+            append(" x10 0x%016llx", value);
+            break;
+        case 5:
+            // vector config prefix and writes to every register file, one
+            // more than a record keeps
+            append(" e32 m1 l4 v8  0x%016llx f3  0x%016llx", value, ~value);
+            append(" x1  0x%016llx c1_fflags 0x%016llx x2  0x%016llx", value + 1, value % 32, value + 2);
+            break;
+        case 6:
+            // a store and a load, with a third access dropped on some lines
+            append(" mem 0x%016llx 0x%016llx mem 0x%016llx", addr, value, addr + 8);
+            if (r % 4 == 0)
+                append(" mem 0x%016llx", addr + 16);
+            break;
+        default:
+            append(" x10 0x%016llx", value >> 3);
+            break;
+        }
+        lines.emplace_back(buf, n);
+    }
+    return lines;
+}
+
+// The first field where a and b differ, or an empty string.
+static std::string first_difference(const TraceRecord &a, const TraceRecord &b)
+{
+    if (a.pc != b.pc)
+        return "pc";
+    if (a.code != b.code)
+        return "code";
+    if (a.core != b.core)
+        return "core";
+    if (a.priv != b.priv)
+        return "priv";
+    if (a.truncated != b.truncated)
+        return "truncated";
+    if (a.reg_write_count != b.reg_write_count)
+        return "reg_write_count";
+    for (std::size_t i = 0; i < a.reg_write_count; i++)
+    {
+        const RegWrite &wa = a.reg_writes[i];
+        const RegWrite &wb = b.reg_writes[i];
+        if (wa.file != wb.file || wa.num != wb.num || wa.value != wb.value)
+            return "reg_writes[" + std::to_string(i) + "]";
+    }
+    if (a.mem_access_count != b.mem_access_count)
+        return "mem_access_count";
+    for (std::size_t i = 0; i < a.mem_access_count; i++)
+    {
+        const MemAccess &ma = a.mem_accesses[i];
+        const MemAccess &mb = b.mem_accesses[i];
+        if (ma.addr != mb.addr || ma.store != mb.store || (ma.store && ma.data != mb.data))
+            return "mem_accesses[" + std::to_string(i) + "]";
+    }
+    return {};
+}
+
+int main()
+{
+    const std::vector<std::string> lines = make_lines();
+    std::vector<TraceRecord> expected(lines.size());
+    for (std::size_t i = 0; i < lines.size(); i++)
+    {
+        if (!parse_trace_record(lines[i], expected[i]))
+        {
+            std::fprintf(stderr, "cannot parse line %zu: %s\n", i, lines[i].c_str());
+            return 1;
+        }
+    }
+
+    const std::string path = (std::filesystem::temp_directory_path() / "binary_trace_check.rvtb").string();
+    {
+        BinaryTraceWriter writer(path, block_records);
+        for (const TraceRecord &record : expected)
+            writer.add(record);
+        writer.finish();
+    }
+    std::ifstream file(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(path);
+
+    BinaryTraceReader reader(data);
+    TraceBlock block;
+    std::size_t index = 0;
+    std::size_t blocks = 0;
+    std::size_t mismatches = 0;
+    while (reader.read_block(block, true))
+    {
+        blocks++;
+        for (std::size_t i = 0; i < block.records.size(); i++, index++)
+        {
+            std::string field = index < expected.size() ? first_difference(expected[index], block.records[i])
+                                                         : std::string("extra record");
+            if (field.empty() && (block.pcs[i] != block.records[i].pc || block.codes[i] != block.records[i].code))
+                field = "pcs/codes column";
+            if (!field.empty())
+            {
+                if (mismatches < 20)
+                    std::fprintf(stderr, "record %zu (block %zu): %s differs\n  %s\n", index, blocks - 1,
+                                 field.c_str(), index < lines.size() ? lines[index].c_str() : "");
+                mismatches++;
+            }
+        }
+    }
+    if (index != expected.size())
+    {
+        std::fprintf(stderr, "read %zu records, wrote %zu\n", index, expected.size());
+        mismatches++;
+    }
+
+    std::printf("binary trace: %zu records in %zu blocks, %zu mismatches\n", expected.size(), blocks, mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,56 @@
+// Checks that the decoders for ISA subsets keep the base-ISA words they
+// share an opcode with extension words: ecall, ebreak and mret sit in the
+// SYSTEM opcode next to the Zicsr instructions.
+//
+//   make check
+
+#include <cstdio>
+
+#include "decoder.hpp"
+
+struct Expectation
+{
+    uint32_t isa;
+    uint32_t code;
+    const char *what;
+    bool known;
+    // IsaExtension bits identify() must report for known words
+    uint32_t ext;
+};
+
+static constexpr Expectation expectations[] = {
+    {ISA_I, 0x00000073, "ecall", true, ISA_I},
+    {ISA_I, 0x00100073, "ebreak", true, ISA_I},
+    {ISA_I, 0x30200073, "mret", true, ISA_I},
+    {ISA_I, 0xc0002073, "rdcycle", false, 0},
+    {ISA_I | ISA_M | ISA_A | ISA_C, 0x00000073, "ecall", true, ISA_I},
+    {ISA_I | ISA_M | ISA_A | ISA_C, 0x00100073, "ebreak", true, ISA_I},
+    {ISA_G | ISA_C | ISA_ZICNTR, 0x00000073, "ecall", true, ISA_I},
+    {ISA_G | ISA_C | ISA_ZICNTR, 0xc0002073, "rdcycle", true, ISA_ZICSR},
+    {ISA_ALL, 0x00100073, "ebreak", true, ISA_I},
+    {ISA_ALL, 0x34129073, "csrw mepc", true, ISA_ZICSR},
+};
+
+int main()
+{
+    std::size_t failures = 0;
+    for (const Expectation &e : expectations)
+    {
+        const IsaDecoder &decoder = select_decoder(e.isa);
+        DecodedInstruction inst{};
+        const bool known = decoder.try_decode(e.code, inst) == DecodeStatus::OK;
+        InstIdentity identity;
+        decoder.identify(e.code, identity);
+
+        if (known != e.known || identity.ext != e.ext)
+        {
+            std::fprintf(stderr, "%s (0x%08x) under isa 0x%x: expected %s with ext 0x%x, got %s with ext 0x%x\n",
+                         e.what, e.code, e.isa, e.known ? "known" : "unknown", e.ext, known ? "known" : "unknown",
+                         identity.ext);
+            failures++;
+        }
+    }
+
+    std::printf("isa subsets: %zu words, %zu failures\n", std::size(expectations), failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,244 @@
+// Checks the 64K compressed decode table against the switch-based RVC
+// decoder it replaced, for every 16-bit encoding: the single-word path
+// (try_decode) and the batch path must both agree with it on whether the
+// word is valid, on name and format, and on every operand. The operands are
+// extracted here from the RVC field layouts, independently of
+// decode_compressed_operands, which the table is built from.
+//
+//   make check
+
+#include <cstdio>
+#include <vector>
+
+#include "decoder.hpp"
+#include "output.hpp"
+
+// Name and format selection of the old decode_compressed() for RV64, which
+// threw where this returns false.
+static bool reference_compressed(uint32_t code, InstEnum &name, InstFormat &format)
+{
+    const uint32_t rd = MASK(code, bitmask_11_7);
+    const uint32_t rs2 = MASK(code, bitmask_6_2);
+
+    switch (MASK(code, bitmask_1_0))
+    {
+    case 0x0:
+    {
+        static constexpr InstEnum names[] = {C_ADDI4SPN, C_FLD, C_LW, C_LD, UNKNOWN, C_FSD, C_SW, C_SD};
+        static constexpr InstFormat formats[] = {InstFormat::CIW, InstFormat::CL, InstFormat::CL, InstFormat::CL,
+                                                 InstFormat::UNKNOWN, InstFormat::CS, InstFormat::CS, InstFormat::CS};
+        name = names[MASK(code, bitmask_15_13)];
+        format = formats[MASK(code, bitmask_15_13)];
+        return name != UNKNOWN;
+    }
+    case 0x1:
+        switch (MASK(code, bitmask_15_13))
+        {
+        case 0x0:
+            name = rd ? C_ADDI : C_NOP;
+            format = InstFormat::CI;
+            return true;
+        case 0x1:
+            name = C_ADDIW;
+            format = InstFormat::CI;
+            return true;
+        case 0x2:
+            name = C_LI;
+            format = InstFormat::CI;
+            return true;
+        case 0x3:
+            if (rd == 0)
+                return false;
+            name = rd == 0x2 ? C_ADDI16SP : C_LUI;
+            format = InstFormat::CI;
+            return true;
+        case 0x4:
+        {
+            static constexpr InstEnum arith[] = {C_SUB, C_XOR, C_OR, C_AND};
+            static constexpr InstEnum shifts[] = {C_SRLI, C_SRAI, C_ANDI};
+            const uint32_t funct2 = MASK(code, bitmask_11_10);
+            name = funct2 == 0x3 ? arith[MASK(code, bitmask_6_5)] : shifts[funct2];
+            format = funct2 == 0x3 ? InstFormat::CA : InstFormat::CB;
+            return true;
+        }
+        case 0x5:
+            name = C_J;
+            format = InstFormat::CJ;
+            return true;
+        case 0x6:
+            name = C_BEQZ;
+            format = InstFormat::CB;
+            return true;
+        default:
+            name = C_BNEZ;
+            format = InstFormat::CB;
+            return true;
+        }
+    case 0x2:
+        switch (MASK(code, bitmask_15_13))
+        {
+        case 0x4:
+            if (!MASK(code, bitmask_12))
+            {
+                name = rs2 ? C_MV : C_JR;
+                format = InstFormat::CR;
+                return true;
+            }
+            if (rd == 0 && rs2 == 0)
+            {
+                name = C_EBREAK;
+                format = InstFormat::CR;
+                return true;
+            }
+            if (rd == 0)
+                return false;
+            name = rs2 ? C_ADD : C_JALR;
+            format = rs2 ? InstFormat::CR : InstFormat::CA;
+            return true;
+        default:
+        {
+            static constexpr InstEnum names[] = {C_SLLI, C_FLDSP, C_LWSP, C_LDSP, UNKNOWN, C_FSDSP, C_SWSP, C_SDSP};
+            static constexpr InstFormat formats[] = {InstFormat::CI, InstFormat::CI, InstFormat::CI,
+                                                     InstFormat::CI, InstFormat::UNKNOWN, InstFormat::CSS,
+                                                     InstFormat::CSS, InstFormat::CSS};
+            name = names[MASK(code, bitmask_15_13)];
+            format = formats[MASK(code, bitmask_15_13)];
+            return true;
+        }
+        }
+    default:
+        return false;
+    }
+}
+
+static uint32_t field(uint32_t code, int hi, int lo)
+{
+    return (code >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+// Gathers the immediate whose bit map[i][1] is bit map[i][0] of code and
+// sign-extends it from its top bit, sign_bit.
+template <std::size_t N>
+static int32_t gather_signed(uint32_t code, const int (&map)[N][2], int sign_bit)
+{
+    uint32_t imm = 0;
+    for (const auto &bit : map)
+        imm |= ((code >> bit[0]) & 0x1) << bit[1];
+    const int shift = 31 - sign_bit;
+    return static_cast<int32_t>(imm << shift) >> shift;
+}
+
+// {code bit, immediate bit}, from the RVC chapter of the ISA manual
+static constexpr int ci_imm_bits[][2] = {{12, 5}, {6, 4}, {5, 3}, {4, 2}, {3, 1}, {2, 0}};
+// c.addi16sp nzimm[9|4|6|8:7|5]
+static constexpr int addi16sp_imm_bits[][2] = {{12, 9}, {6, 4}, {5, 6}, {4, 8}, {3, 7}, {2, 5}};
+// c.beqz/c.bnez offset[8|4:3] and offset[7:6|2:1|5]
+static constexpr int cb_offset_bits[][2] = {{12, 8}, {11, 4}, {10, 3}, {6, 7}, {5, 6}, {4, 2}, {3, 1}, {2, 5}};
+// c.j offset[11|4|9:8|10|6|7|3:1|5]
+static constexpr int cj_offset_bits[][2] = {{12, 11}, {11, 4}, {10, 9}, {9, 8},  {8, 10}, {7, 6},
+                                            {6, 7},   {5, 3},  {4, 2},  {3, 1}, {2, 5}};
+
+// Operands of the old decoder for each format: register fields as laid out in
+// the encoding, the CB/CJ offsets and the c.addi16sp immediate as byte
+// offsets, and the raw immediate field for the other formats.
+static void reference_operands(uint32_t code, DecodedInstruction &inst)
+{
+    switch (inst.format)
+    {
+    case InstFormat::CR:
+        inst.rd = field(code, 11, 7);
+        inst.rs2 = field(code, 6, 2);
+        break;
+    case InstFormat::CI:
+        inst.rd = field(code, 11, 7);
+        inst.imm = inst.name == C_ADDI16SP ? gather_signed(code, addi16sp_imm_bits, 9)
+                                           : gather_signed(code, ci_imm_bits, 5);
+        break;
+    case InstFormat::CSS:
+        inst.rs2 = field(code, 6, 2);
+        inst.imm = field(code, 12, 7) << 3;
+        break;
+    case InstFormat::CIW:
+        inst.rd = field(code, 4, 2);
+        inst.imm = field(code, 12, 5);
+        break;
+    case InstFormat::CL:
+        inst.rs1 = field(code, 9, 7);
+        inst.rd = field(code, 4, 2);
+        break;
+    case InstFormat::CS:
+        inst.rs1 = field(code, 9, 7);
+        inst.rs2 = field(code, 4, 2);
+        break;
+    case InstFormat::CA:
+        inst.rd = field(code, 9, 7);
+        inst.rs2 = field(code, 4, 2);
+        break;
+    case InstFormat::CB:
+        inst.rd = field(code, 9, 7);
+        if (inst.name == C_BEQZ || inst.name == C_BNEZ)
+            inst.imm = gather_signed(code, cb_offset_bits, 8);
+        break;
+    case InstFormat::CJ:
+        inst.imm = gather_signed(code, cj_offset_bits, 11);
+        break;
+    default:
+        break;
+    }
+}
+
+static bool same_instruction(const DecodedInstruction &a, const DecodedInstruction &b)
+{
+    OutputBuffer out_a;
+    OutputBuffer out_b;
+    a.print_payload(out_a);
+    b.print_payload(out_b);
+    return a.code == b.code && a.imm == b.imm && a.name == b.name && a.format == b.format && a.rd == b.rd &&
+           a.rs1 == b.rs1 && a.rs2 == b.rs2 && a.rs3 == b.rs3 && a.compressed == b.compressed &&
+           out_a.view() == out_b.view();
+}
+
+int main()
+{
+    const IsaDecoder &decoder = select_decoder(ISA_ALL);
+
+    std::vector<uint32_t> codes;
+    for (uint32_t code = 0; code < (1 << 16); code++)
+        if ((code & 0x3) != 0x3)
+            codes.push_back(code);
+    std::vector<DecodedInstruction> batch(codes.size());
+    decoder.decode_batch(codes, batch);
+
+    std::size_t valid = 0;
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < codes.size(); i++)
+    {
+        const uint32_t code = codes[i];
+        DecodedInstruction expected{};
+        expected.code = code;
+        expected.compressed = true;
+        const bool expected_valid = reference_compressed(code, expected.name, expected.format);
+        if (expected_valid)
+            reference_operands(code, expected);
+
+        DecodedInstruction single{};
+        const bool single_valid = decoder.try_decode(code, single) == DecodeStatus::OK;
+
+        bool ok = single_valid == expected_valid && batch[i].is_known() == expected_valid;
+        if (ok && expected_valid)
+            ok = same_instruction(single, expected) && same_instruction(batch[i], expected);
+        if (!ok)
+        {
+            if (mismatches < 20)
+                std::fprintf(stderr, "mismatch for 0x%04x: expected %s, try_decode %s, decode_batch %s\n", code,
+                             expected_valid ? std::string(expected.mnemonic()).c_str() : "invalid",
+                             single_valid ? std::string(single.mnemonic()).c_str() : "invalid",
+                             batch[i].is_known() ? std::string(batch[i].mnemonic()).c_str() : "invalid");
+            mismatches++;
+        }
+        valid += expected_valid;
+    }
+
+    std::printf("rvc table: %zu encodings, %zu valid, %zu mismatches\n", codes.size(), valid, mismatches);
+    return mismatches ? 1 : 0;
+}